@@ -0,0 +1,211 @@
+#include <chrono>
+#include <iostream>
+
+#include "assetloader.hpp"
+#include "objloader.hpp"
+
+namespace assetloader {
+
+const void* Model::getVertexData() const {
+    // already in the layout of ModelSettings::packVertices
+    if (cache) {
+        return cache->getVertexData();
+    }
+    if (!packedVertices.empty()) {
+        return packedVertices.data();
+    }
+    return view.vertices;
+}
+
+const void* Model::getIndexData() const {
+    // already split for 16 bits indices if it could be
+    if (cache) {
+        return cache->getIndexData();
+    }
+    if (indexBuffer.indexType == VK_INDEX_TYPE_UINT16) {
+        return indexBuffer.indices16.data();
+    }
+    return view.indices;
+}
+
+/** takes the parsed (or generated) mesh: view points in the model vectors */
+static void setMesh(Model& model, mesh::Mesh&& mesh) {
+    model.vertices = std::move(mesh.vertices);
+    model.indices = std::move(mesh.indices);
+
+    model.view.vertices = model.vertices.data();
+    model.view.vertexCount = model.vertices.size();
+    model.view.indices = model.indices.data();
+    model.view.indexCount = model.indices.size();
+}
+
+/** what the vertex buffer holds, and so the cache */
+static meshcache::VertexLayout getVertexLayout(const ModelSettings& settings) {
+    if (settings.packVertices) {
+        return meshcache::getVertexLayout<vertex::PackedVertex>();
+    }
+    return meshcache::getVertexLayout<vertex::Vertex>();
+}
+
+/** everything but the vertex layout that changes what is in the cache */
+static uint64_t getImportKey(const ModelSettings& settings) {
+    uint64_t key = meshopt::hashOptions(settings.importOptions);
+
+    // the index blob is split for 16 bits indices or not
+    key ^= settings.use16BitIndices ? 1 : 0;
+    key *= 1099511628211ull;
+
+    return key;
+}
+
+/** for a parsed (or generated) mesh: the cache has it all done already */
+static void prepareForGpu(Model& model, const ModelSettings& settings) {
+    // without levels of detail, the whole index buffer is the only level
+    if (model.lods.empty()) {
+        model.lods.push_back(lod::Lod{0, static_cast<uint32_t>(model.view.indexCount), 0.0f});
+    }
+
+    if (settings.packVertices) {
+        model.packedVertices = quantize::packVertices(model.view.vertices, model.view.vertexCount, model.bounds);
+        model.positionDequantization = quantize::getPositionDequantization(model.bounds);
+    }
+
+    model.indexBuffer = indexbuffer::build(model.view.indices, model.view.indexCount, !settings.use16BitIndices);
+}
+
+Model loadModel(const ModelSettings& settings) {
+    Model model;
+    uint64_t importKey = getImportKey(settings);
+
+    // fast path: nothing to parse, the buffers are copied from the mapping
+    auto cache = std::make_unique<meshcache::MappedMesh>();
+    if (cache->open(settings.cachePath, settings.modelPath, getVertexLayout(settings), importKey)) {
+        // the buffers are uploaded from the mapping, nothing to quantize or split
+        model.view.vertexCount = cache->getVertexCount();
+        model.view.indexCount = cache->getIndexCount();
+        model.indexBuffer.indexType = cache->getIndexType();
+        model.indexBuffer.submeshes.assign(cache->getSubmeshes(), cache->getSubmeshes() + cache->getSubmeshCount());
+        model.bounds = cache->getBounds();
+        model.positionDequantization = cache->getPositionDequantization();
+        model.meshlets.assign(cache->getMeshlets(), cache->getMeshlets() + cache->getMeshletCount());
+        model.lods.assign(cache->getLods(), cache->getLods() + cache->getLodCount());
+        model.cache = std::move(cache);
+        if (settings.verbose) {
+            std::cout << "model: loaded from " << settings.cachePath << std::endl;
+        }
+
+        return model;
+    }
+
+    // mmap'ed and parsed on all the cores, identical vertices welded
+    // (tinyobj::LoadObj was single threaded and parsed one vertex per face corner)
+    mesh::Mesh mesh = objloader::load(settings.modelPath);
+
+    if (settings.verbose) {
+        std::cout << "model: " << mesh.indices.size() << " indices, "
+            << mesh.vertices.size() << " unique vertices" << std::endl;
+    }
+
+    // reorder the triangles for the post-transform cache and the overdraw,
+    // then the vertices in order of use
+    // only done once, the result is in the cache file
+    meshopt::Extras extras;
+    meshopt::Report report = meshopt::optimize(mesh, settings.importOptions, &extras);
+    model.meshlets = std::move(extras.meshlets);
+    model.lods = std::move(extras.lods);
+
+    if (settings.verbose) {
+        if (settings.importOptions.analyze) {
+            std::cout << "model: ACMR " << report.cacheBefore.acmr << " -> " << report.cacheAfter.acmr
+                << ", ATVR " << report.cacheBefore.atvr << " -> " << report.cacheAfter.atvr
+                << ", overdraw " << report.overdrawBefore.overdraw << " -> " << report.overdrawAfter.overdraw
+                << std::endl;
+        }
+
+        std::cout << "model: " << model.meshlets.size() << " meshlets" << std::endl;
+
+        for (size_t i = 0; i < model.lods.size(); i++) {
+            std::cout << "model: lod " << i << ", " << model.lods[i].indexCount / 3 << " triangles, error "
+                << model.lods[i].error << std::endl;
+        }
+    }
+
+    setMesh(model, std::move(mesh));
+    model.bounds = mesh::computeBounds(model.view.vertices, model.view.vertexCount);
+
+    prepareForGpu(model, settings);
+
+    // the buffers as uploaded: the next runs do not quantize or split them again
+    meshcache::VertexBlob vertexBlob;
+    vertexBlob.data = model.getVertexData();
+    vertexBlob.count = model.view.vertexCount;
+    vertexBlob.layout = getVertexLayout(settings);
+    vertexBlob.positionDequantization = model.positionDequantization;
+
+    meshcache::IndexBlob indexBlob;
+    indexBlob.data = model.getIndexData();
+    indexBlob.count = model.view.indexCount;
+    indexBlob.indexType = model.indexBuffer.indexType;
+    indexBlob.submeshes = model.indexBuffer.submeshes.data();
+    indexBlob.submeshCount = model.indexBuffer.submeshes.size();
+
+    // not being able to write the cache is not fatal, we will parse again next time
+    try {
+        meshcache::write(
+            settings.cachePath,
+            settings.modelPath,
+            vertexBlob,
+            indexBlob,
+            model.bounds,
+            model.meshlets,
+            model.lods,
+            importKey
+        );
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    return model;
+}
+
+Model createPlaceholderModel(const ModelSettings& settings, float halfExtent) {
+    Model model;
+
+    setMesh(model, mesh::createCube(halfExtent));
+    model.bounds = mesh::computeBounds(model.view.vertices, model.view.vertexCount);
+
+    prepareForGpu(model, settings);
+    return model;
+}
+
+void Loader::start(const ModelSettings& modelSettings, const char* texturePath) {
+    // std::launch::async: a thread right now, not a lazy call in get()
+    model_ = std::async(std::launch::async, loadModel, modelSettings);
+    texture_ = std::async(std::launch::async, texture::decodeImage, texturePath);
+}
+
+template <class T>
+static bool isFutureReady(const std::future<T>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool Loader::isReady() const {
+    if (!isPending()) {
+        return false;
+    }
+    return (!model_.valid() || isFutureReady(model_)) && (!texture_.valid() || isFutureReady(texture_));
+}
+
+bool Loader::isPending() const {
+    return model_.valid() || texture_.valid();
+}
+
+Model Loader::takeModel() {
+    return model_.get();
+}
+
+texture::DecodedImage Loader::takeTexture() {
+    return texture_.get();
+}
+
+}
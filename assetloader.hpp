@@ -0,0 +1,103 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "mesh.hpp"
+#include "meshcache.hpp"
+#include "meshopt.hpp"
+#include "meshlet.hpp"
+#include "lod.hpp"
+#include "quantize.hpp"
+#include "indexbuffer.hpp"
+#include "texture.hpp"
+
+namespace assetloader {
+
+/** how a model is imported and prepared for the GPU */
+struct ModelSettings {
+    const char* modelPath = nullptr;
+    /** parsed and optimized once, mapped on the next runs */
+    const char* cachePath = nullptr;
+    meshopt::Options importOptions{};
+    /** fills Model::packedVertices */
+    bool packVertices = true;
+    bool use16BitIndices = true;
+    /** prints the import results, from the loader thread */
+    bool verbose = false;
+};
+
+/**
+ * Everything the renderer needs from a model, ready to be uploaded:
+ * built on a worker thread, moved to the render thread in one piece.
+ */
+struct Model {
+    /**
+     * set if loaded from the cache: its vertex and index blobs are uploaded as they are,
+     * view only has the counts
+     */
+    std::unique_ptr<meshcache::MappedMesh> cache;
+    /** set if parsed (or generated): view points in them */
+    std::vector<vertex::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    mesh::MeshView view;
+    mesh::Bounds bounds{};
+    /** clusters of the full resolution triangles with their culling data, empty if not built */
+    std::vector<meshlet::Meshlet> meshlets;
+    /** ranges of the index buffer, the full resolution first, at least one */
+    std::vector<lod::Lod> lods;
+    /** view.vertices quantized, if ModelSettings::packVertices and not loaded from the cache */
+    std::vector<vertex::PackedVertex> packedVertices;
+    quantize::PositionDequantization positionDequantization{glm::vec3(1.0f), glm::vec3(0.0f)};
+    /** the indices as uploaded (indices16 empty if loaded from the cache), and the submeshes to draw them */
+    indexbuffer::IndexBuffer indexBuffer;
+
+    /** what goes in the vertex buffer, view.vertexCount vertices */
+    const void* getVertexData() const;
+    /** what goes in the index buffer, view.indexCount indices of indexBuffer.indexType */
+    const void* getIndexData() const;
+};
+
+/**
+ * Blocking: from the cache if it is valid, otherwise parsed, optimized,
+ * quantized and written in the cache for the next runs. Then indexed for the GPU.
+ * No Vulkan call: meant for a worker thread (see Loader).
+ */
+Model loadModel(const ModelSettings& settings);
+
+/** a cube of halfExtent, prepared like a loaded model: drawn until the real one is there */
+Model createPlaceholderModel(const ModelSettings& settings, float halfExtent);
+
+/**
+ * Loading a big model and its texture takes seconds (parsing, optimizing, decoding)
+ * while the window stays black. The loader does this CPU work on worker threads,
+ * the model and the texture in parallel, and the render loop polls it once per frame:
+ * it draws placeholders until both are ready, then uploads them and switches
+ * to them once the upload completed (without waiting on the GPU either).
+ *
+ * start() -> isReady() every frame -> takeModel() / takeTexture()
+ *
+ * An exception on a worker is thrown again by take*().
+ * The destructor waits for the workers if they are still running.
+ */
+class Loader {
+public:
+    void start(const ModelSettings& modelSettings, const char* texturePath);
+
+    /** true once both the model and the texture are loaded (or failed), never blocks */
+    bool isReady() const;
+
+    /** started and not taken yet */
+    bool isPending() const;
+
+    Model takeModel();
+    texture::DecodedImage takeTexture();
+
+private:
+    std::future<Model> model_;
+    std::future<texture::DecodedImage> texture_;
+};
+
+}
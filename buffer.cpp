@@ -3,7 +3,6 @@
 #include <array>
 
 #include "buffer.hpp"
-#include "commandbuffer.hpp"
 
 namespace buffer
 {
@@ -48,13 +47,13 @@ uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, Vk
 }
 
 void bindBuffer(
-    VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
+    memory::Allocator& allocator,
     VkDeviceSize size,
     VkBufferUsageFlags usage,
-    VkMemoryPropertyFlags properties,
+    const memorytype::Request& memoryRequest,
     VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory
+    memory::Allocation& bufferAllocation
 ) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -76,101 +75,96 @@ void bindBuffer(
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(logicalDevice, buffer, &memRequirements);
     
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        physicalDevice,
-        memRequirements.memoryTypeBits, 
-        properties
-    );
-
-    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
+    // no vkAllocateMemory per buffer, we get a range of a bigger block
+    // (see maxMemoryAllocationCount in the README)
+    bufferAllocation = allocator.allocate(memRequirements, memoryRequest, memory::ResourceKind::Linear);
 
     // memory allocation successful, so bind it to the buffer
-    vkBindBufferMemory(logicalDevice, buffer, bufferMemory, 0);
+    // at the offset of our range in the block
+    vkBindBufferMemory(logicalDevice, buffer, bufferAllocation.memory, bufferAllocation.offset);
 }
 
 void copyBuffer(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    VkCommandBuffer commandBuffer,
     VkBuffer srcBuffer,
     VkBuffer dstBuffer,
-    VkDeviceSize size
+    VkDeviceSize size,
+    VkDeviceSize srcOffset,
+    VkDeviceSize dstOffset
 ) {
-    VkCommandBuffer commandBuffer = commandbuffer::beginSingleTimeCommands(
-      logicalDevice,
-      commandPool  
-    );
-
     // we have to use regions array (of VkBufferCopy structs)
     // we can't use VK_WHOLE_SIZE like VkMapMemory
     VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
+    // e.g. the region of the staging ring
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    commandbuffer::endAndExecuteSingleTimeCommands(
-        logicalDevice,
-        commandPool,
-        graphicsQueue,
-        commandBuffer
-    );
 }
 
-void createUniformBuffers(
-    VkPhysicalDevice physicalDevice,
+void createBuffer(
+    Type bufferType,
     VkDevice logicalDevice,
-    int maxFramesInFlight,
-    std::vector<VkBuffer>& uniformBuffers,
-    std::vector<VkDeviceMemory>& uniformBuffersMemory,
-    std::vector<void*>& uniformBuffersMapped
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
+    const void* data,
+    VkDeviceSize size,
+    VkBuffer& buffer,
+    memory::Allocation& bufferAllocation
 ) {
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-    uniformBuffers.resize(maxFramesInFlight);
-    uniformBuffersMemory.resize(maxFramesInFlight);
-    uniformBuffersMapped.resize(maxFramesInFlight);
-
-    for (size_t i = 0; i < maxFramesInFlight; i++) {
-        bindBuffer(
-            physicalDevice,
-            logicalDevice,
-            bufferSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            uniformBuffers[i],
-            uniformBuffersMemory[i]);
-
-        // The buffer stays mapped the whole application time
-        // as mapping has a cost, it is best to avoid doing it every time
-        // this is called "persistent mapping"
-        vkMapMemory(logicalDevice, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
-    }
+    auto buffer_bit = (bufferType == Type::Vertex) ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+    bindBuffer(
+        logicalDevice,
+        allocator,
+        size,
+        // vkMap usualy not possible as device local
+        // hence we specify it can be used as a transfer destination
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | buffer_bit,
+        // The most optimal memory on the GPU, but usually not accessible from the CPU
+        // hence the use of a staging buffer
+        memorytype::GPU_ONLY,
+        buffer,
+        bufferAllocation
+    );
+
+    /**
+     * Unfortunately the driver may not immediately copy the data 
+     * into the buffer memory, for example because of caching. 
+     * It is also possible that writes to the buffer are not visible 
+     * in the mapped memory yet. There are two ways to deal with that problem:
+     * * Use a memory heap that is host coherent, indicated with VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+     * * Call vkFlushMappedMemoryRanges after writing to the mapped memory, 
+     * and call vkInvalidateMappedMemoryRanges before reading from the mapped memory
+     * 
+     * We went for the first approach with the staging ring, which ensures that the mapped memory
+     * always matches the contents of the allocated memory. Do keep in mind that this may lead to slightly 
+     * worse performance than explicit flushing.
+     */
+    uploadBatch.copyToBuffer(data, size, buffer);
 }
 
 void createDescriptorPool(
     VkDevice logicalDevice,
-    int maxFramesInFlight,
+    int maxMaterials,
     VkDescriptorPool& descriptorPool
 ) {
+    // the frame set and the object set: the uniforms are in the uniform arena,
+    // addressed with dynamic offsets, one set of each for all the frames
+    const uint32_t uniformSetCount = 2;
+
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    // we will allocate one descriptor set by frame
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(maxFramesInFlight);
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = uniformSetCount;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    // we will allocate one descriptor set by frame
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(maxFramesInFlight);
+    // we will allocate one descriptor set by material
+    poolSizes[1].descriptorCount = static_cast<uint32_t>(maxMaterials);
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());;
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(maxFramesInFlight);
+    poolInfo.maxSets = uniformSetCount + static_cast<uint32_t>(maxMaterials);
     // We're not going to touch the descriptor set after creating it, so we don't need this flag
     // optional
     poolInfo.flags = 0;
@@ -198,113 +192,146 @@ void createDescriptorPool(
     }
 }
 
-void createDescriptorSetLayout(
+static void createDescriptorSetLayout(
     VkDevice logicalDevice,
+    VkDescriptorType descriptorType,
+    VkShaderStageFlags stageFlags,
     VkDescriptorSetLayout& descriptorSetLayout
 ) {
-    // For uniform
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    // with have only one MVP
-    uboLayoutBinding.descriptorCount = 1;
+    VkDescriptorSetLayoutBinding layoutBinding{};
+    layoutBinding.binding = 0;
+    layoutBinding.descriptorType = descriptorType;
+    layoutBinding.descriptorCount = 1;
     // in which shader stage it will be referenced
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    layoutBinding.stageFlags = stageFlags;
     // only relevant for image sampling descriptors, optional
-    uboLayoutBinding.pImmutableSamplers = nullptr;
+    layoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &layoutBinding;
+
+    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+}
+
+void createDescriptorSetLayouts(
+    VkDevice logicalDevice,
+    std::vector<VkDescriptorSetLayout>& descriptorSetLayouts
+) {
+    descriptorSetLayouts.resize(SET_COUNT);
+
+    // For the view and projection
+    // dynamic: the offset in the buffer is given when binding the set,
+    // one set for all the frames (see uniformarena::UniformArena)
+    createDescriptorSetLayout(
+        logicalDevice,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        descriptorSetLayouts[FRAME_SET]
+    );
 
     // For texture sampler
-    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorCount = 1;
     // Combined image sampler descriptor allow shaders to access image resource
     // through a sampler
-    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
     // we intend to use the combined image descriptor sampler in the fragment shader
     // It is also possible to use texture sampling in the vertex shader, 
     // for example to dynamically deform a grid of vertices by a heightmap.
-    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
+    createDescriptorSetLayout(
+        logicalDevice,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        descriptorSetLayouts[MATERIAL_SET]
+    );
 
-    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create descriptor set layout!");
-    }
+    // For the uniforms of each object, one set for all of them
+    createDescriptorSetLayout(
+        logicalDevice,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        descriptorSetLayouts[OBJECT_SET]
+    );
 }
 
-void createDescriptorSets(
+static void allocateDescriptorSet(
     VkDevice logicalDevice,
-    int maxFramesInFlight,
-    const std::vector<VkBuffer>& uniformBuffers,
     const VkDescriptorPool& descriptorPool,
     VkDescriptorSetLayout descriptorSetLayout,
-    const VkImageView& textureImageView,
-    const VkSampler& textureSampler,
-    std::vector<VkDescriptorSet>& descriptorSets
+    VkDescriptorSet& descriptorSet
 ) {
-    // one descriptor set for each frame in flight,
-    // all with the same layout
-    std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(maxFramesInFlight);
-    allocInfo.pSetLayouts = layouts.data();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
 
-    descriptorSets.resize(maxFramesInFlight);
-    // this calls allocate descriptor sets, each with one buffer descriptor
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
+}
 
-    // configure the descriptor sets we just allocated
-    for (size_t i = 0; i < maxFramesInFlight; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i];
-        bufferInfo.offset = 0;
-        // we could also use VK_WHOLE_SIZE here as
-        // we overwrite the whole buffer
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = textureImageView;
-        imageInfo.sampler = textureSampler;
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        // descriptors could be array, here it is not
-        // so the index is 0
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        // in case of an array, use only 1. Not it is starting at dstArrayElement
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        // descriptors could be array, here it is not
-        // so the index is 0
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        // in case of an array, use only 1. Not it is starting at dstArrayElement
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-
-        // accepts two kind of array:
-        // VkWriteDescriptorSet and an array of VkCopyDescriptorSet
-        vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-    }
+void createUniformDescriptorSet(
+    VkDevice logicalDevice,
+    VkBuffer uniformBuffer,
+    VkDeviceSize range,
+    const VkDescriptorPool& descriptorPool,
+    VkDescriptorSetLayout descriptorSetLayout,
+    VkDescriptorSet& descriptorSet
+) {
+    allocateDescriptorSet(logicalDevice, descriptorPool, descriptorSetLayout, descriptorSet);
+
+    VkDescriptorBufferInfo bufferInfo{};
+    // the same buffer for all the frames: the region of the frame
+    // is part of the dynamic offset given at bind time
+    bufferInfo.buffer = uniformBuffer;
+    bufferInfo.offset = 0;
+    // what one bind sees from its dynamic offset
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    // descriptors could be array, here it is not
+    // so the index is 0
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    // in case of an array, use only 1. Not it is starting at dstArrayElement
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    // accepts two kind of array:
+    // VkWriteDescriptorSet and an array of VkCopyDescriptorSet
+    vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+void createMaterialDescriptorSet(
+    VkDevice logicalDevice,
+    const VkDescriptorPool& descriptorPool,
+    VkDescriptorSetLayout descriptorSetLayout,
+    const VkImageView& textureImageView,
+    const VkSampler& textureSampler,
+    VkDescriptorSet& descriptorSet
+) {
+    allocateDescriptorSet(logicalDevice, descriptorPool, descriptorSetLayout, descriptorSet);
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = textureImageView;
+    imageInfo.sampler = textureSampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, nullptr);
 }
 
 }
@@ -7,6 +7,9 @@
 #include "GLFW/glfw3.h"
 #include "glm/glm.hpp"
 
+#include "memory.hpp"
+#include "upload.hpp"
+
 namespace buffer
 {
 
@@ -15,170 +18,174 @@ enum Type {
     Index
 };
 
-/** returns the memoryType index */
+/**
+ * returns the memoryType index, the first one with the properties.
+ * The allocator uses memorytype::Selector instead.
+ */
 uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+/**
+ * The descriptor sets, by update frequency: a set stays bound while a set
+ * of a lower index changes, so the per object one, changed for each object, is the last.
+ * The numbers are the set = N of the shaders (shader9.vert, shader10.vert, shader4.frag).
+ */
+enum SetIndex : uint32_t {
+    /** FrameUniforms, bound once per frame */
+    FRAME_SET = 0,
+    /** the texture, bound when the material changes */
+    MATERIAL_SET = 1,
+    /** ObjectUniforms, bound for each object with its dynamic offset */
+    OBJECT_SET = 2,
+    SET_COUNT = 3
+};
+
 /**
  * The data in the matrices is binary compatible with the way 
- * the shader expects it, so we can later just memcpy a UniformBufferObject to a VkBuffer.
+ * the shader expects it, so we can later just memcpy a FrameUniforms to a VkBuffer.
+ * The model matrix is not in it, see DrawPushConstants.
  * 
  * alignas is to ensure proper memory alignment with Vulkan
- * here for the 3 matricies the default will be OK
+ * here for the 2 matricies the default will be OK
  * but beeing explicit could avoid gotchas with more complicated
  * or nested structs
  */
-struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
+struct FrameUniforms {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
 };
 
+/** what is specific to an object but too big or too rare to be pushed with each draw */
+struct ObjectUniforms {
+    /**
+     * dequantization of vertex::PackedVertex positions (shader10.vert),
+     * ignored by the shaders reading float positions.
+     * vec4 because a vec3 has the alignment of a vec4 in the uniform block anyway
+     */
+    alignas(16) glm::vec4 positionScale;
+    alignas(16) glm::vec4 positionOffset;
+};
+
+/**
+ * Per draw data, given with vkCmdPushConstants instead of a uniform buffer:
+ * written in the command buffer itself, no memory write or descriptor change per object.
+ * Push constants are small (128 bytes guaranteed by the spec) and laid out like std430:
+ * the uint right after the matrix, at offset 64.
+ */
+struct DrawPushConstants {
+    glm::mat4 model;
+    /** which material of the draw, not read by the shaders yet (only one texture) */
+    uint32_t materialIndex;
+};
+
+/**
+ * creates the buffer and binds it to a sub allocation of allocator.
+ * host visible memory is persistently mapped, see bufferAllocation.mapped
+ */
 void bindBuffer(
-    VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
+    memory::Allocator& allocator,
     VkDeviceSize size,
     VkBufferUsageFlags usage,
-    VkMemoryPropertyFlags properties,
+    const memorytype::Request& memoryRequest,
     VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory
+    memory::Allocation& bufferAllocation
 );
 
+/** only records the copy in commandBuffer */
 void copyBuffer(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    VkCommandBuffer commandBuffer,
     VkBuffer srcBuffer,
     VkBuffer dstBuffer,
-    VkDeviceSize size
+    VkDeviceSize size,
+    VkDeviceSize srcOffset = 0,
+    VkDeviceSize dstOffset = 0
+);
+
+/**
+ * creates a device local buffer of size bytes, the copy of data into it
+ * is recorded in uploadBatch: the buffer can be used once the batch is submitted
+ */
+void createBuffer(
+    Type bufferType,
+    VkDevice logicalDevice,
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
+    const void* data,
+    VkDeviceSize size,
+    VkBuffer& buffer,
+    memory::Allocation& bufferAllocation
 );
 
 template <class T>
 void createBuffer(
     Type bufferType,
-    VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
     const std::vector<T>& itemList,
     VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory
+    memory::Allocation& bufferAllocation
 ) {
-    VkDeviceSize bufferSize = sizeof(itemList[0]) * itemList.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    bindBuffer(
-        physicalDevice,
+    createBuffer(
+        bufferType,
         logicalDevice,
-        bufferSize,
-        // no more VK_BUFFER_USAGE_VERTEX_BUFFER_BIT as we are
-        // creating a staging buffer
-        // Buffer can be used as source in a memory transfer operation.
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory
-    );
-
-    // fill the staging buffer
-    void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-
-    /**
-     * Unfortunately the driver may not immediately copy the data 
-     * into the buffer memory, for example because of caching. 
-     * It is also possible that writes to the buffer are not visible 
-     * in the mapped memory yet. There are two ways to deal with that problem:
-     * * Use a memory heap that is host coherent, indicated with VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-     * * Call vkFlushMappedMemoryRanges after writing to the mapped memory, 
-     * and call vkInvalidateMappedMemoryRanges before reading from the mapped memory
-     * 
-     * We went for the first approach, which ensures that the mapped memory always matches
-     * the contents of the allocated memory. Do keep in mind that this may lead to slightly 
-     * worse performance than explicit flushing.bufferSize
-     * 
-     * But now we are dealing with a staging buffer, TODO: does it matter with a staging buffer ?
-     */
-    memcpy(data, itemList.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-    auto buffer_bit = (bufferType == Type::Vertex) ? VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-
-    bindBuffer(
-        physicalDevice,
-        logicalDevice,
-        bufferSize,
-        // vkMap usualy not possible as device local
-        // hence we specify it can be used as a transfer destination
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | buffer_bit,
-        // The most optimal memory on the GPU, but usually not accessible from the CPU
-        // hence the use of a staging buffer
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        allocator,
+        uploadBatch,
+        itemList.data(),
+        sizeof(itemList[0]) * itemList.size(),
         buffer,
-        bufferMemory
+        bufferAllocation
     );
-
-    copyBuffer(logicalDevice, commandPool, graphicsQueue, stagingBuffer, buffer, bufferSize);
-
-    // we can now clean the staging buffer
-    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
 }
 
 /**
- * We're going to copy new data to the uniform buffer every frame,
- * so it doesn't really make any sense to have a staging buffer.
- * It would just add extra overhead in this case and likely degrade performance instead of improving it.
- * We should have multiple buffers,
- * because multiple frames may be in flight at the same time and we don't want to update the buffer
- * in preparation of the next frame while a previous one is still reading from it! Thus, we need
- * to have as many uniform buffers as we have frames in flight, and write to a uniform buffer
- * that is not currently being read by the GPU
- */
-void createUniformBuffers(
-    VkPhysicalDevice physicalDevice,
-    VkDevice logicalDevice,
-    int maxFramesInFlight,
-    std::vector<VkBuffer>& uniformBuffers,
-    std::vector<VkDeviceMemory>& uniformBuffersMemory,
-    std::vector<void*>& uniformBuffersMapped
-);
-
-/**
- * Descriptor sets can't be created directly, they must be allocated from a pool like command buffers
+ * Descriptor sets can't be created directly, they must be allocated from a pool like command buffers.
+ * Room for the frame and the object sets, and maxMaterials material sets.
  */
 void createDescriptorPool(
     VkDevice logicalDevice,
-    int maxFramesInFlight,
+    int maxMaterials,
     VkDescriptorPool& descriptorPool
 );
 
 /**
  * A descriptor is a way for shaders to freely access resources like buffers and images.
- * We will use it for uniforms (uniforms exist to avoid copy for exemple a view model projection
+ * We will use it for uniforms (uniforms exist to avoid copy for exemple a view projection
  * matric for each fram in a vertex buffer)
- * and for textures
+ * and for textures.
+ * One layout per SetIndex, each with a single descriptor at binding 0.
  */
-void createDescriptorSetLayout(
+void createDescriptorSetLayouts(
     VkDevice logicalDevice,
-    VkDescriptorSetLayout& descriptorSetLayout
+    std::vector<VkDescriptorSetLayout>& descriptorSetLayouts
 );
 
 /**
  * The descriptor layout describes the type of descriptors that can be bound.
- * Here we're going to create a descriptor set for each VkBuffer resource to bind
- * it to the uniform buffer descriptor and the combined image sampler.
+ * A set for the frame or the object one: a dynamic uniform buffer of range bytes
+ * in uniformBuffer (see uniformarena::UniformArena). Its offset is given when binding it,
+ * so a single set serves all the frames in flight and all the objects.
+ */
+void createUniformDescriptorSet(
+    VkDevice logicalDevice,
+    VkBuffer uniformBuffer,
+    VkDeviceSize range,
+    const VkDescriptorPool& descriptorPool,
+    VkDescriptorSetLayout descriptorSetLayout,
+    VkDescriptorSet& descriptorSet
+);
+
+/**
+ * A material set: the combined image sampler of the texture.
+ * Never updated, a new set is allocated for a new texture.
  */
-void createDescriptorSets(
+void createMaterialDescriptorSet(
     VkDevice logicalDevice,
-    int maxFramesInFlight,
-    const std::vector<VkBuffer>& uniformBuffers,
     const VkDescriptorPool& descriptorPool,
     VkDescriptorSetLayout descriptorSetLayout,
     const VkImageView& textureImageView,
     const VkSampler& textureSampler,
-    std::vector<VkDescriptorSet>& descriptorSets
+    VkDescriptorSet& descriptorSet
 );
 
 
@@ -1,67 +1,175 @@
+#include <stdexcept>
+
 #include "commandbuffer.hpp"
 
 namespace commandbuffer {
 
-VkCommandBuffer beginSingleTimeCommands(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool
-) {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+void TransientPool::init(VkDevice logicalDevice, uint32_t queueFamily) {
+    logicalDevice_ = logicalDevice;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     /**
-     * You may wish to create a separate command pool for these kinds of short-lived buffers,
-     * because the implementation may be able to apply memory allocation optimizations.
-     * You should use the VK_COMMAND_POOL_CREATE_TRANSIENT_BIT flag during command pool
-     * generation in that case.
-     * 
-     * TODO: create a command buffer, pool function
-     * TODO: dedicated command pool for memory transfer
-     * for now we use the command commandPool_ but WARNING: it has to be created
-     * before calling this function, or it will SEGFAULT at vkAllocateCommandBuffers
+     * A separate command pool for these kinds of short-lived buffers:
+     * the implementation may be able to apply memory allocation optimizations
+     * with VK_COMMAND_POOL_CREATE_TRANSIENT_BIT.
+     * The command buffers are reused, vkBeginCommandBuffer resets them implicitly
      */
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
 
+    if (vkCreateCommandPool(logicalDevice_, &poolInfo, nullptr, &commandPool_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transient command pool!");
+    }
+}
+
+void TransientPool::destroy() {
+    // frees its command buffers
+    vkDestroyCommandPool(logicalDevice_, commandPool_, nullptr);
+
+    commandPool_ = VK_NULL_HANDLE;
+    freeCommandBuffers_.clear();
+}
+
+VkCommandBuffer TransientPool::beginSingleTimeCommands() {
     VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
+
+    if (!freeCommandBuffers_.empty()) {
+        commandBuffer = freeCommandBuffers_.back();
+        freeCommandBuffers_.pop_back();
+    } else {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool_;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(logicalDevice_, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate transient command buffer!");
+        }
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    // We're only going to use the command buffer once and wait with returning 
-    // from the function until the copy operation has finished executing
+    // We're only going to submit the recording once
     // good practice: tell the driver our intent
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     // start recording
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording transient command buffer!");
+    }
 
     return commandBuffer;
 }
 
-void endAndExecuteSingleTimeCommands(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
-    VkCommandBuffer commandBuffer
+Submission TransientPool::submitSingleTimeCommands(
+    VkQueue queue,
+    timeline::Timeline& queueTimeline,
+    VkCommandBuffer commandBuffer,
+    const std::vector<timeline::Wait>& waits
 ) {
     // end recording
-    vkEndCommandBuffer(commandBuffer);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record transient command buffer!");
+    }
+
+    Submission submission;
+    submission.commandBuffer = commandBuffer;
+    // a timeline point instead of vkQueueWaitIdle: the caller waits for this work only,
+    // and only when it needs the result
+    submission.point = queueTimeline.next();
+
+    timeline::submit(queue, {commandBuffer}, waits, {submission.point});
+
+    return submission;
+}
+
+bool TransientPool::isComplete(const Submission& submission) const {
+    return timeline::isReached(logicalDevice_, submission.point);
+}
+
+void TransientPool::wait(Submission& submission) {
+    timeline::wait(logicalDevice_, submission.point);
+
+    recycle(submission.commandBuffer);
+    submission = Submission{};
+}
+
+void TransientPool::recycle(VkCommandBuffer commandBuffer) {
+    // reset by the next vkBeginCommandBuffer
+    freeCommandBuffers_.push_back(commandBuffer);
+}
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+void RecordingCache::init(VkDevice logicalDevice, VkCommandPool commandPool, uint32_t frameCount, uint32_t imageCount) {
+    logicalDevice_ = logicalDevice;
+    commandPool_ = commandPool;
+    imageCount_ = imageCount;
 
-    // execute the command buffer
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    // there is no event to wait, unlike the draw command
-    // we juste want to execute immediately
-    // two way to wait for the transfer to complete:
-    // * vkWaitForFence (would allow us to schedule multiple transfer simultaneously)
-    // * vkQueueWaitIdle
-    vkQueueWaitIdle(graphicsQueue);
+    commandBuffers_.resize(frameCount * imageCount);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool_;
+    // VK_COMMAND_BUFFER_LEVEL_PRIMARY: Can be submitted to a queue
+    // for execution, but cannot be called from other command buffers.
+    // VK_COMMAND_BUFFER_LEVEL_SECONDARY: Cannot be submitted directly
+    // but can be called from primary command buffers.
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers_.size());
+
+    if (vkAllocateCommandBuffers(logicalDevice_, &allocInfo, commandBuffers_.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+
+    // all dirty: never recorded
+    recordedVersions_.assign(commandBuffers_.size(), 0);
+    version_ = 1;
+}
+
+void RecordingCache::destroy() {
+    if (!commandBuffers_.empty()) {
+        vkFreeCommandBuffers(
+            logicalDevice_,
+            commandPool_,
+            static_cast<uint32_t>(commandBuffers_.size()),
+            commandBuffers_.data()
+        );
+    }
+
+    commandBuffers_.clear();
+    recordedVersions_.clear();
+}
+
+uint32_t RecordingCache::getSlot(uint32_t frame, uint32_t imageIndex) const {
+    // with one image per frame, the image does not matter
+    return frame * imageCount_ + imageIndex % imageCount_;
+}
+
+uint32_t RecordingCache::getSlotCount() const {
+    return static_cast<uint32_t>(commandBuffers_.size());
+}
+
+VkCommandBuffer RecordingCache::get(uint32_t slot) const {
+    return commandBuffers_[slot];
+}
+
+bool RecordingCache::isDirty(uint32_t slot) const {
+    return recordedVersions_[slot] != version_;
+}
+
+void RecordingCache::markRecorded(uint32_t slot) {
+    recordedVersions_[slot] = version_;
+}
+
+void RecordingCache::invalidate() {
+    version_++;
+}
+
+void RecordingCache::invalidateFrame(uint32_t frame) {
+    for (uint32_t image = 0; image < imageCount_; image++) {
+        recordedVersions_[frame * imageCount_ + image] = 0;
+    }
+}
 
-    vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
 }
-}
\ No newline at end of file
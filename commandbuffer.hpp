@@ -1,21 +1,114 @@
 #pragma once
 
+#include <vector>
+#include <cstdint>
+
 // Let GLFW include by itslef vulkan headers
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
 
+#include "timeline.hpp"
+
 namespace commandbuffer {
 
-VkCommandBuffer beginSingleTimeCommands(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool
-);
+/** a submitted command buffer and the timeline point to wait on */
+struct Submission {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    timeline::Point point;
+};
+
+/**
+ * The single time commands used to allocate a command buffer from the pool of the frames,
+ * submit it, vkQueueWaitIdle, and free it: a driver allocation and a full stall each time.
+ *
+ * This pool is for one-off work only (VK_COMMAND_POOL_CREATE_TRANSIENT_BIT), on one queue family.
+ * The command buffers given back to it are recycled instead of freed:
+ * after a few submissions nothing is allocated anymore.
+ * The submissions signal the timeline of the queue, no fence is involved.
+ *
+ * beginSingleTimeCommands() -> record -> submitSingleTimeCommands() -> isComplete() / wait()
+ *
+ * Not thread safe, like the command pool it wraps.
+ */
+class TransientPool {
+public:
+    void init(VkDevice logicalDevice, uint32_t queueFamily);
+
+    /** the device must be idle: every submission completed */
+    void destroy();
+
+    /** a recycled command buffer if there is one, recording (one time submit) */
+    VkCommandBuffer beginSingleTimeCommands();
+
+    /**
+     * ends the recording and submits on queue (of the pool family) after waits, does not wait.
+     * queueTimeline is the timeline of queue
+     */
+    Submission submitSingleTimeCommands(
+        VkQueue queue,
+        timeline::Timeline& queueTimeline,
+        VkCommandBuffer commandBuffer,
+        const std::vector<timeline::Wait>& waits = {}
+    );
+
+    /** never blocks */
+    bool isComplete(const Submission& submission) const;
+
+    /** blocks until the submission is executed, then recycles its command buffer */
+    void wait(Submission& submission);
+
+    /** for the callers submitting by themselves (e.g. upload::Batch), once executed */
+    void recycle(VkCommandBuffer commandBuffer);
+
+private:
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    VkCommandPool commandPool_ = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> freeCommandBuffers_;
+};
+
+/**
+ * The scene is static most of the time: only the content of the uniforms changes,
+ * not the commands. Recording the same commands every frame is wasted CPU time.
+ *
+ * One primary command buffer per frame in flight and swap chain image (slot),
+ * recorded once and submitted again as long as nothing it uses changed.
+ * The caller tells what changed: invalidate() for what all the slots use
+ * (draws, pipelines, descriptor sets, framebuffers), invalidateFrame() for what is
+ * per frame in flight (dynamic offsets of the uniforms of the frame).
+ * A command buffer of a frame is never pending when the frame is recorded
+ * (its timeline point was waited on): it can be recorded or submitted again.
+ *
+ * With imageCount 1, one per frame in flight: invalidate() every frame to record every frame.
+ *
+ * getSlot(frame, image) -> isDirty(slot) ? record get(slot), markRecorded(slot) -> submit get(slot)
+ */
+class RecordingCache {
+public:
+    /** allocated from commandPool, which must allow resetting them one by one */
+    void init(VkDevice logicalDevice, VkCommandPool commandPool, uint32_t frameCount, uint32_t imageCount);
+
+    /** frees the command buffers, none of them may be pending */
+    void destroy();
+
+    uint32_t getSlot(uint32_t frame, uint32_t imageIndex) const;
+    uint32_t getSlotCount() const;
+    VkCommandBuffer get(uint32_t slot) const;
+
+    bool isDirty(uint32_t slot) const;
+    void markRecorded(uint32_t slot);
+
+    void invalidate();
+    void invalidateFrame(uint32_t frame);
 
-void endAndExecuteSingleTimeCommands(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
-    VkCommandBuffer commandBuffer
-);
+private:
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    VkCommandPool commandPool_ = VK_NULL_HANDLE;
+    uint32_t imageCount_ = 1;
+    std::vector<VkCommandBuffer> commandBuffers_;
+    /** the version each slot was recorded at, 0 for never */
+    std::vector<uint64_t> recordedVersions_;
+    /** incremented by invalidate(): the slots recorded before are dirty */
+    uint64_t version_ = 1;
+};
 
-}
\ No newline at end of file
+}
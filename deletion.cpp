@@ -0,0 +1,85 @@
+#include <utility>
+
+#include "deletion.hpp"
+
+namespace deletion {
+
+void Queue::init(uint32_t frameCount) {
+    frames_.assign(frameCount, {});
+    currentFrame_ = 0;
+}
+
+void Queue::beginFrame(uint32_t frame) {
+    currentFrame_ = frame;
+
+    // moved out first: a destruction may retire something else
+    std::vector<std::function<void()>> retired = std::move(frames_[frame]);
+    frames_[frame].clear();
+
+    for (auto& destroy : retired) {
+        destroy();
+    }
+}
+
+void Queue::retire(std::function<void()> destroy) {
+    frames_[currentFrame_].push_back(std::move(destroy));
+}
+
+void Queue::flush() {
+    uint32_t current = currentFrame_;
+
+    // the oldest frames first, then again until nothing is retired anymore
+    bool isEmpty = false;
+    while (!isEmpty) {
+        isEmpty = true;
+        for (uint32_t i = 1; i <= frames_.size(); i++) {
+            uint32_t frame = static_cast<uint32_t>((current + i) % frames_.size());
+            if (!frames_[frame].empty()) {
+                isEmpty = false;
+                beginFrame(frame);
+            }
+        }
+    }
+
+    currentFrame_ = current;
+}
+
+Allocation::Allocation(Queue& queue, memory::Allocator& allocator, const memory::Allocation& allocation)
+    : queue_(&queue), allocator_(&allocator), allocation_(allocation) {}
+
+Allocation::~Allocation() {
+    reset();
+}
+
+Allocation::Allocation(Allocation&& other) noexcept
+    : queue_(other.queue_), allocator_(other.allocator_), allocation_(other.allocation_) {
+    other.allocation_ = memory::Allocation{};
+}
+
+Allocation& Allocation::operator=(Allocation&& other) noexcept {
+    if (this != &other) {
+        reset();
+        queue_ = other.queue_;
+        allocator_ = other.allocator_;
+        allocation_ = other.allocation_;
+        other.allocation_ = memory::Allocation{};
+    }
+    return *this;
+}
+
+const memory::Allocation& Allocation::get() const {
+    return allocation_;
+}
+
+void Allocation::reset() {
+    if (allocation_.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    memory::Allocator* allocator = allocator_;
+    memory::Allocation allocation = allocation_;
+    queue_->retire([allocator, allocation]() mutable { allocator->free(allocation); });
+    allocation_ = memory::Allocation{};
+}
+
+}
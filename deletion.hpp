@@ -0,0 +1,136 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "memory.hpp"
+
+namespace deletion {
+
+/**
+ * A resource can't be destroyed while a frame in flight still uses it, and
+ * vkDeviceWaitIdle before each replacement stalls the whole GPU.
+ *
+ * Each frame in flight has its bucket: what is retired while recording a frame
+ * goes in the bucket of that frame, and is destroyed the next time the timeline point of
+ * that frame is reached (beginFrame). By then every frame submitted before the
+ * retirement has completed too, as its own point was waited on in between.
+ * The resource must not be used by the frames recorded after its retirement.
+ *
+ * drawFrame: timeline::wait(point of frame) -> beginFrame(frame) -> retire() ... -> submit
+ */
+class Queue {
+public:
+    void init(uint32_t frameCount);
+
+    /** the point of frame reached: destroys what was retired the last time frame was recorded */
+    void beginFrame(uint32_t frame);
+
+    /** destroy is called once the frames in flight are done */
+    void retire(std::function<void()> destroy);
+
+    /** destroys everything now, the device must be idle (e.g. after vkDeviceWaitIdle at cleanup) */
+    void flush();
+
+private:
+    /** in retirement order, e.g. a view before its image */
+    std::vector<std::vector<std::function<void()>>> frames_;
+    uint32_t currentFrame_ = 0;
+};
+
+/**
+ * Owns a Vulkan handle (move only): when reset, assigned over or destroyed,
+ * the handle is retired in the queue instead of destroyed right away.
+ * Destroy is the vkDestroy* function of the handle type.
+ */
+template <class Handle, void (VKAPI_PTR *Destroy)(VkDevice, Handle, const VkAllocationCallbacks*)>
+class Owned {
+public:
+    Owned() = default;
+
+    Owned(Queue& queue, VkDevice logicalDevice, Handle handle)
+        : queue_(&queue), logicalDevice_(logicalDevice), handle_(handle) {}
+
+    ~Owned() {
+        reset();
+    }
+
+    Owned(const Owned&) = delete;
+    Owned& operator=(const Owned&) = delete;
+
+    Owned(Owned&& other) noexcept
+        : queue_(other.queue_), logicalDevice_(other.logicalDevice_), handle_(other.release()) {}
+
+    Owned& operator=(Owned&& other) noexcept {
+        if (this != &other) {
+            reset();
+            queue_ = other.queue_;
+            logicalDevice_ = other.logicalDevice_;
+            handle_ = other.release();
+        }
+        return *this;
+    }
+
+    Handle get() const {
+        return handle_;
+    }
+
+    /** gives up the ownership, nothing is destroyed */
+    Handle release() {
+        Handle handle = handle_;
+        handle_ = VK_NULL_HANDLE;
+        return handle;
+    }
+
+    /** destroyed once the frames in flight are done with it */
+    void reset() {
+        if (handle_ == VK_NULL_HANDLE) {
+            return;
+        }
+
+        VkDevice logicalDevice = logicalDevice_;
+        Handle handle = handle_;
+        queue_->retire([logicalDevice, handle]() { Destroy(logicalDevice, handle, nullptr); });
+        handle_ = VK_NULL_HANDLE;
+    }
+
+private:
+    Queue* queue_ = nullptr;
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    Handle handle_ = VK_NULL_HANDLE;
+};
+
+using Buffer = Owned<VkBuffer, vkDestroyBuffer>;
+using Image = Owned<VkImage, vkDestroyImage>;
+using ImageView = Owned<VkImageView, vkDestroyImageView>;
+using Sampler = Owned<VkSampler, vkDestroySampler>;
+using Pipeline = Owned<VkPipeline, vkDestroyPipeline>;
+using PipelineLayout = Owned<VkPipelineLayout, vkDestroyPipelineLayout>;
+
+/** the same for a sub allocation of memory::Allocator, given back to it once the frames are done */
+class Allocation {
+public:
+    Allocation() = default;
+    Allocation(Queue& queue, memory::Allocator& allocator, const memory::Allocation& allocation);
+    ~Allocation();
+
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+    Allocation(Allocation&& other) noexcept;
+    Allocation& operator=(Allocation&& other) noexcept;
+
+    const memory::Allocation& get() const;
+    void reset();
+
+private:
+    Queue* queue_ = nullptr;
+    memory::Allocator* allocator_ = nullptr;
+    memory::Allocation allocation_;
+};
+
+}
@@ -197,7 +197,7 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceK
 
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
             VkBool32 presentationSupport = false;
             vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentationSupport);
             // Note: likely to be the same queue family
@@ -207,7 +207,20 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceK
                 indices.presentationFamily = i;
             }
             indices.graphicsFamily = i;
-            break;
+        }
+
+        // no break anymore, we also look for a transfer only family.
+        // Graphics and compute families implicitly support transfer,
+        // so a family without them is the one dedicated to transfers.
+        // Prefer one without compute too (the "pure" DMA queue)
+        bool isTransferOnly = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
+            && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+
+        if (isTransferOnly) {
+            bool hasCompute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+            if (!indices.transferFamily.has_value() || !hasCompute) {
+                indices.transferFamily = i;
+            }
         }
 
         i++;
@@ -229,10 +242,26 @@ bool isPhysicalDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surf
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentationModes.empty();
     }
 
-    VkPhysicalDeviceFeatures supportedFeatures;
-    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    // the synchronization is built on timeline semaphores: core since Vulkan 1.2
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    // checked first: the 1.2 feature structure can't be chained for an older device
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    // the extended features are chained behind the core ones
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate
+        && supportedFeatures.features.samplerAnisotropy && timelineFeatures.timelineSemaphore;
 }
 
 bool checkValidationLayerSupport(const std::vector<const char*>& validation_layers) {
@@ -319,7 +348,8 @@ void createLogicalDevice(
     const std::vector<const char*>& validation_layers,
     VkDevice* pLogicalDevice,
     VkQueue* pGraphicsQueue,
-    VkQueue* pPresentQueue
+    VkQueue* pPresentQueue,
+    VkQueue* pTransferQueue
     ) {
     // Specify the queues to be created
     // TODO: dedicated function ?
@@ -327,9 +357,11 @@ void createLogicalDevice(
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     // we are interested in queues with graphics and presentation capabilities
+    // and transfer, if there is a dedicated family for it
     std::set<uint32_t> uniqueQueueFamilies = {
         indices.graphicsFamily.value(),
-        indices.presentationFamily.value()
+        indices.presentationFamily.value(),
+        indices.getTransferFamily()
     };
 
     // This is required even if there is only a single queue:
@@ -360,8 +392,14 @@ void createLogicalDevice(
     // anisotropic filtering is an optional feature
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // checked by isPhysicalDeviceSuitable
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &timelineFeatures;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -394,6 +432,7 @@ void createLogicalDevice(
     // if the queues are the same, it is more than likely than handles will be the same
     vkGetDeviceQueue(*pLogicalDevice, indices.graphicsFamily.value(), 0, pGraphicsQueue);
     vkGetDeviceQueue(*pLogicalDevice, indices.presentationFamily.value(), 0, pPresentQueue);
+    vkGetDeviceQueue(*pLogicalDevice, indices.getTransferFamily(), 0, pTransferQueue);
 }
 
 VkFormat findSupportedDepthImageFormat(
@@ -12,9 +12,19 @@ namespace device {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentationFamily;
+    /**
+     * a family with transfer but without graphics capabilities,
+     * usually backed by the DMA engines of discrete GPUs.
+     * Optional: many devices (integrated GPUs, lavapipe) do not have one
+     */
+    std::optional<uint32_t> transferFamily;
     bool isComplete() {
         return graphicsFamily.has_value() && presentationFamily.has_value();
     }
+    /** the dedicated transfer family if any, the graphics one otherwise */
+    uint32_t getTransferFamily() {
+        return transferFamily.value_or(graphicsFamily.value());
+    }
 };
 
 void printExtensions();
@@ -88,7 +98,9 @@ void createLogicalDevice(
     const std::vector<const char*>& validation_layers,
     VkDevice* pLogicalDevice,
     VkQueue* pGraphicsQueue,
-    VkQueue* pPresentQueue
+    VkQueue* pPresentQueue,
+    // same as pGraphicsQueue when there is no dedicated transfer family
+    VkQueue* pTransferQueue
 );
 
 /**
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "geometrypool.hpp"
+#include "buffer.hpp"
+
+namespace geometrypool {
+
+/** indices start on 4 bytes: a whole number of 16 or 32 bits indices from the start of the buffer */
+static const VkDeviceSize INDEX_ALIGNMENT = 4;
+
+void GeometryPool::init(
+    VkDevice logicalDevice,
+    memory::Allocator& allocator,
+    uint32_t vertexStride,
+    VkDeviceSize vertexBufferSize,
+    VkDeviceSize indexBufferSize
+) {
+    logicalDevice_ = logicalDevice;
+    allocator_ = &allocator;
+    vertexStride_ = vertexStride;
+    vertexBufferSize_ = vertexBufferSize;
+    indexBufferSize_ = indexBufferSize;
+
+    // device local, only written by the copies of the upload batches,
+    // unless the CPU can write all the VRAM: then mapped and written in place
+    memoryRequest_ = memorytype::GPU_ONLY;
+    if (allocator.getMemoryTypes().hasLargeMappableDeviceMemory()) {
+        memoryRequest_ = memorytype::Request(
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+    }
+
+    // the first block right away: the usual meshes all go in it
+    addBlock(vertexBufferSize_, indexBufferSize_);
+}
+
+void GeometryPool::addBlock(VkDeviceSize vertexBufferSize, VkDeviceSize indexBufferSize) {
+    Block block;
+
+    buffer::bindBuffer(
+        logicalDevice_,
+        *allocator_,
+        vertexBufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        memoryRequest_,
+        block.vertexBuffer,
+        block.vertexBufferAllocation
+    );
+
+    buffer::bindBuffer(
+        logicalDevice_,
+        *allocator_,
+        indexBufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        memoryRequest_,
+        block.indexBuffer,
+        block.indexBufferAllocation
+    );
+
+    // coherent: the writes are visible to the GPU at the next submission, no flush
+    const memorytype::Selector& memoryTypes = allocator_->getMemoryTypes();
+    auto isCoherentlyMapped = [&](const memory::Allocation& allocation) {
+        return allocation.mapped != nullptr
+            && (memoryTypes.getFlags(allocation.memoryTypeIndex) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    };
+    block.isDirectWrite = isCoherentlyMapped(block.vertexBufferAllocation)
+        && isCoherentlyMapped(block.indexBufferAllocation);
+
+    block.freeVertices.reset(vertexBufferSize / vertexStride_);
+    block.freeIndexBytes.reset(indexBufferSize);
+
+    blocks_.push_back(block);
+}
+
+void GeometryPool::destroy(memory::Allocator& allocator) {
+    for (Block& block : blocks_) {
+        vkDestroyBuffer(logicalDevice_, block.vertexBuffer, nullptr);
+        allocator.free(block.vertexBufferAllocation);
+        vkDestroyBuffer(logicalDevice_, block.indexBuffer, nullptr);
+        allocator.free(block.indexBufferAllocation);
+    }
+
+    blocks_.clear();
+}
+
+bool GeometryPool::allocate(Block& block, uint32_t vertexCount, VkDeviceSize indexByteSize, MeshRange& range) {
+    VkDeviceSize firstVertex;
+    if (!block.freeVertices.allocate(vertexCount, 1, firstVertex)) {
+        return false;
+    }
+
+    VkDeviceSize indexByteOffset;
+    if (!block.freeIndexBytes.allocate(indexByteSize, INDEX_ALIGNMENT, indexByteOffset)) {
+        block.freeVertices.free(firstVertex, vertexCount);
+        return false;
+    }
+
+    uint32_t indexSize = range.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    range.vertexOffset = static_cast<int32_t>(firstVertex);
+    range.vertexCount = vertexCount;
+    range.firstIndex = static_cast<uint32_t>(indexByteOffset / indexSize);
+    range.indexByteSize = indexByteSize;
+
+    return true;
+}
+
+MeshRange GeometryPool::upload(
+    upload::Batch& uploadBatch,
+    const void* vertices,
+    uint32_t vertexCount,
+    const void* indices,
+    uint32_t indexCount,
+    VkIndexType indexType
+) {
+    uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    VkDeviceSize indexByteSize = static_cast<VkDeviceSize>(indexCount) * indexSize;
+
+    MeshRange range;
+    range.indexCount = indexCount;
+    range.indexType = indexType;
+
+    bool isAllocated = false;
+    for (uint32_t i = 0; i < blocks_.size() && !isAllocated; i++) {
+        isAllocated = allocate(blocks_[i], vertexCount, indexByteSize, range);
+        range.block = i;
+    }
+
+    // no room in the existing blocks: a new one, big enough for this mesh
+    if (!isAllocated) {
+        addBlock(
+            std::max(vertexBufferSize_, static_cast<VkDeviceSize>(vertexCount) * vertexStride_),
+            std::max(indexBufferSize_, memory::alignUp(indexByteSize, INDEX_ALIGNMENT))
+        );
+        range.block = static_cast<uint32_t>(blocks_.size() - 1);
+        // can't fail, the block is empty and big enough
+        allocate(blocks_.back(), vertexCount, indexByteSize, range);
+    }
+
+    Block& block = blocks_[range.block];
+    VkDeviceSize firstVertex = static_cast<VkDeviceSize>(range.vertexOffset);
+    VkDeviceSize indexByteOffset = static_cast<VkDeviceSize>(range.firstIndex) * indexSize;
+
+    // the ranges are new: no frame in flight reads them, they can be written right away
+    // the frames drawing the mesh are submitted after this write
+    if (block.isDirectWrite) {
+        memcpy(
+            static_cast<char*>(block.vertexBufferAllocation.mapped) + firstVertex * vertexStride_,
+            vertices,
+            static_cast<size_t>(vertexCount) * vertexStride_
+        );
+        memcpy(static_cast<char*>(block.indexBufferAllocation.mapped) + indexByteOffset, indices, indexByteSize);
+        return range;
+    }
+
+    // the ownership transfer barriers of the batch only cover these ranges:
+    // the other meshes of the pool can be drawn meanwhile
+    uploadBatch.copyToBuffer(
+        vertices,
+        static_cast<VkDeviceSize>(vertexCount) * vertexStride_,
+        block.vertexBuffer,
+        firstVertex * vertexStride_
+    );
+    uploadBatch.copyToBuffer(indices, indexByteSize, block.indexBuffer, indexByteOffset);
+
+    return range;
+}
+
+void GeometryPool::free(MeshRange& range) {
+    if (range.vertexCount == 0 && range.indexByteSize == 0) {
+        return;
+    }
+
+    uint32_t indexSize = range.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // empty blocks are kept, like memory::Allocator does: the next model goes there
+    Block& block = blocks_[range.block];
+    block.freeVertices.free(static_cast<VkDeviceSize>(range.vertexOffset), range.vertexCount);
+    block.freeIndexBytes.free(static_cast<VkDeviceSize>(range.firstIndex) * indexSize, range.indexByteSize);
+
+    range = MeshRange{};
+}
+
+VkBuffer GeometryPool::getVertexBuffer(uint32_t block) const {
+    return blocks_[block].vertexBuffer;
+}
+
+VkBuffer GeometryPool::getIndexBuffer(uint32_t block) const {
+    return blocks_[block].indexBuffer;
+}
+
+uint32_t GeometryPool::getVertexStride() const {
+    return vertexStride_;
+}
+
+bool GeometryPool::isDirectWrite() const {
+    for (const Block& block : blocks_) {
+        if (!block.isDirectWrite) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "memory.hpp"
+#include "upload.hpp"
+
+namespace geometrypool {
+
+/** of each block, a bigger mesh gets a block of its size */
+const VkDeviceSize DEFAULT_VERTEX_BUFFER_SIZE = 32 * 1024 * 1024;
+const VkDeviceSize DEFAULT_INDEX_BUFFER_SIZE = 16 * 1024 * 1024;
+
+/**
+ * Where a mesh lives in the pool, in the units vkCmdDrawIndexed wants:
+ * add firstIndex and vertexOffset to the ones of each draw of the mesh
+ */
+struct MeshRange {
+    /** the block of the pool holding the mesh, see getVertexBuffer / getIndexBuffer */
+    uint32_t block = 0;
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    /** in indices of indexType, the index buffer is bound at offset 0 */
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    /** in bytes, 0 if nothing allocated */
+    VkDeviceSize indexByteSize = 0;
+};
+
+/**
+ * One vertex buffer and one index buffer per pool instead of a pair per mesh:
+ * the meshes are sub allocated in ranges of them and drawn with the firstIndex / vertexOffset
+ * of vkCmdDrawIndexed. The buffers are bound once for all the meshes, and draws of
+ * different meshes can later be merged (e.g. in one indirect draw).
+ *
+ * All the meshes share the vertex layout (vertexStride). 16 and 32 bits indices can be mixed:
+ * every index range starts on 4 bytes, so its firstIndex is exact in both units,
+ * only vkCmdBindIndexBuffer has to be called again when the type changes.
+ *
+ * Like memory::Allocator, the pool is made of blocks, a pair of buffers each, whose free space
+ * is a memory::FreeList. A new block is created when a mesh fits in none of them:
+ * the meshes of a block are drawn with its buffers bound.
+ *
+ * With resizable BAR or unified memory (memorytype::Selector::hasLargeMappableDeviceMemory)
+ * the buffers are host visible VRAM: the meshes are written in place, without staging copies.
+ */
+class GeometryPool {
+public:
+    void init(
+        VkDevice logicalDevice,
+        memory::Allocator& allocator,
+        uint32_t vertexStride,
+        VkDeviceSize vertexBufferSize = DEFAULT_VERTEX_BUFFER_SIZE,
+        VkDeviceSize indexBufferSize = DEFAULT_INDEX_BUFFER_SIZE
+    );
+
+    /** the GPU must not use the buffers anymore */
+    void destroy(memory::Allocator& allocator);
+
+    /**
+     * allocates the ranges and records the copies in uploadBatch
+     * (or writes them directly, see isDirectWrite()):
+     * the mesh can be drawn once the batch is submitted.
+     * Adds a block (at least the size of the mesh) if it fits in none.
+     */
+    MeshRange upload(
+        upload::Batch& uploadBatch,
+        const void* vertices,
+        uint32_t vertexCount,
+        const void* indices,
+        uint32_t indexCount,
+        VkIndexType indexType
+    );
+
+    /** the GPU must not use the mesh anymore, range is reset */
+    void free(MeshRange& range);
+
+    /** block: MeshRange::block */
+    VkBuffer getVertexBuffer(uint32_t block) const;
+    VkBuffer getIndexBuffer(uint32_t block) const;
+    uint32_t getVertexStride() const;
+    /** the buffers are mapped: upload() writes them without staging */
+    bool isDirectWrite() const;
+
+private:
+    struct Block {
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        memory::Allocation vertexBufferAllocation;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        memory::Allocation indexBufferAllocation;
+        bool isDirectWrite = false;
+        /** in vertices */
+        memory::FreeList freeVertices;
+        /** in bytes */
+        memory::FreeList freeIndexBytes;
+    };
+
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    memory::Allocator* allocator_ = nullptr;
+    memorytype::Request memoryRequest_;
+    uint32_t vertexStride_ = 0;
+    VkDeviceSize vertexBufferSize_ = 0;
+    VkDeviceSize indexBufferSize_ = 0;
+    std::vector<Block> blocks_;
+
+    void addBlock(VkDeviceSize vertexBufferSize, VkDeviceSize indexBufferSize);
+    /** false if the mesh does not fit in block */
+    bool allocate(Block& block, uint32_t vertexCount, VkDeviceSize indexByteSize, MeshRange& range);
+};
+
+}
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <chrono>
 #include <memory>
+#include <cmath>
 
 // Let GLFW include by itslef vulkan headers
 #define GLFW_INCLUDE_VULKAN
@@ -22,9 +23,6 @@
 #include "glm/gtc/matrix_transform.hpp"
 // to easily print glm vec
 #include "glm/gtx/string_cast.hpp"
-// could be only in one file in the project
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 
 #include "device.hpp"
 #include "swapchain.hpp"
@@ -35,12 +33,31 @@
 #include "texture.hpp"
 #include "image.hpp"
 #include "commandbuffer.hpp"
+#include "memory.hpp"
+#include "staging.hpp"
+#include "upload.hpp"
+#include "mesh.hpp"
+#include "meshcache.hpp"
+#include "objloader.hpp"
+#include "meshopt.hpp"
+#include "quantize.hpp"
+#include "meshlet.hpp"
+#include "lod.hpp"
+#include "indexbuffer.hpp"
+#include "assetloader.hpp"
+#include "geometrypool.hpp"
+#include "uniformarena.hpp"
+#include "deletion.hpp"
+#include "timeline.hpp"
+#include "recorder.hpp"
 
 #ifdef NDEBUG
     const bool ENABLE_VALIDATION_LAYERS = false;
 #else
     const bool ENABLE_VALIDATION_LAYERS = true;
 #endif
+/** prints what the model loading and the geometry pool did (from the loader thread too) */
+const bool VERBOSE = false;
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
@@ -49,6 +66,8 @@ const uint32_t HEIGHT = 600;
  *  Note that rougher primitives like vkDeviceWaitIdle are also possible
  */
 const int MAX_FRAMES_IN_FLIGHT = 2;
+/** the usual uploads go through it, a bigger one gets a staging buffer of its own */
+const VkDeviceSize STAGING_RING_SIZE = 16 * 1024 * 1024;
 
 const std::vector<const char*> VALIDATION_LAYERS = {
     "VK_LAYER_KHRONOS_validation"
@@ -60,10 +79,55 @@ const std::vector<const char*> DEVICE_EXTENSIONS = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
-const auto VERT_FILE = "./shaders/spirv/shader5.vert.spirv";
-const auto FRAG_FILE = "./shaders/spirv/shader3.frag.spirv";
+const auto VERT_FILE = "./shaders/spirv/shader9.vert.spirv";
+const auto FRAG_FILE = "./shaders/spirv/shader4.frag.spirv";
 const auto TEXTURE_PATH = "./models/viking_room.png";
 const auto MODEL_PATH = "models/viking_room.obj";
+/** binary version of the model, written on the first run */
+const auto MODEL_CACHE_PATH = "models/viking_room.meshcache";
+/**
+ * vertex::PackedVertex (16 bytes) instead of vertex::Vertex (32 bytes) in the vertex buffer,
+ * with the vertex shader dequantizing the positions
+ */
+const bool USE_PACKED_VERTICES = true;
+const auto PACKED_VERT_FILE = "./shaders/spirv/shader10.vert.spirv";
+/** 16 bits indices (split in submeshes for big meshes), or the 32 bits ones as loaded */
+const bool USE_16BIT_INDICES = true;
+/**
+ * one command buffer per frame in flight and swap chain image, recorded again only when
+ * what they draw changes, or one per frame in flight recorded every frame
+ */
+const bool CACHE_COMMAND_BUFFERS = true;
+/**
+ * import pipeline stages, e.g. overdraw = false for a mesh seen from one side only
+ * (the cache is rebuilt when they change), the before / after report only when VERBOSE prints it
+ */
+const meshopt::Options MESH_IMPORT_OPTIONS = [] {
+    meshopt::Options options;
+    options.analyze = VERBOSE;
+    return options;
+}();
+/**
+ * a coarser level of detail is drawn when its error, projected on the screen,
+ * is under this many pixels: the switch is then hard to notice
+ */
+const float LOD_PIXEL_ERROR = 1.0f;
+/** loaded in the background, see assetloader::Loader */
+const assetloader::ModelSettings MODEL_SETTINGS{
+    MODEL_PATH,
+    MODEL_CACHE_PATH,
+    MESH_IMPORT_OPTIONS,
+    USE_PACKED_VERTICES,
+    USE_16BIT_INDICES,
+    VERBOSE
+};
+/** drawn until the model and its texture are loaded */
+const float PLACEHOLDER_HALF_EXTENT = 0.5f;
+/** 2x2 RGBA grey checker */
+const uint8_t PLACEHOLDER_PIXELS[] = {
+    160, 160, 160, 255,   96,  96,  96, 255,
+     96,  96,  96, 255,  160, 160, 160, 255
+};
 
 void errorCallback(int error, const char* description)
 {
@@ -129,6 +193,8 @@ private:
      */
     VkQueue graphicsQueue_;
     VkQueue presentationQueue_;
+    /** dedicated transfer queue, or graphicsQueue_ if the device has none */
+    VkQueue transferQueue_;
     VkSurfaceKHR surface_;
     VkSwapchainKHR swapChain_;
     /** Images will be destroyed when Swap Chain is destroyed */
@@ -137,18 +203,32 @@ private:
     VkExtent2D swapChainExtent_;
     std::vector<VkImageView> swapChainImageViews_;
     VkRenderPass renderPass_;
-    VkDescriptorSetLayout descriptorSetLayout_;
+    // one per buffer::SetIndex
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts_;
     VkPipelineLayout pipelineLayout_;
     VkPipeline graphicsPipeline_;
     std::vector<VkFramebuffer> swapChainFramebuffers_;
     VkCommandPool commandPool_;
-    std::vector<VkCommandBuffer> commandBuffers_;
+    /** command pools are tied to a queue family: one for the uploads on each */
+    commandbuffer::TransientPool transferTransientPool_;
+    commandbuffer::TransientPool graphicsTransientPool_;
+    commandbuffer::RecordingCache commandBufferCache_;
+    /** what the cached command buffers were recorded with, see invalidateChangedCommandBuffers */
+    std::vector<indexbuffer::Submesh> recordedDraws_;
+    buffer::DrawPushConstants recordedDrawConstants_{};
+    /** per frame in flight: frame and model uniforms */
+    std::vector<std::array<uint32_t, 2>> recordedUniformOffsets_;
+    /** the draws in secondary command buffers, on worker threads */
+    recorder::ParallelRecorder drawRecorder_;
     /** Semaphore: blocking wait in GPU not in CPU */
     std::vector<VkSemaphore> imageAvailableSemaphores_;
     /** Semaphore: blocking wait in GPU not in CPU */
     std::vector<VkSemaphore> renderFinishedSemaphores_;
-    /** Fence blocking wait on CPU that GPU has finished */
-    std::vector<VkFence> inFlightFences_;
+    /** one timeline per queue: every submission on it signals its next value */
+    timeline::Timeline graphicsTimeline_;
+    timeline::Timeline transferTimeline_;
+    /** blocking wait on CPU that GPU has finished the frame, reached while nothing was submitted */
+    std::vector<timeline::Point> framePoints_;
     /** keep track of the current frame */
     uint32_t currentFrame_ = 0;
     /**
@@ -156,31 +236,65 @@ private:
      *  VK_ERROR_OUT_OF_DATE_KHR when window is resized
      */
     bool framebufferResized_ = false;
-    VkBuffer vertexBuffer_;
-    VkDeviceMemory vertexBufferMemory_;
-    VkBuffer indexBuffer_;
-    VkDeviceMemory indexBufferMemory_;
-    std::vector<VkBuffer> uniformBuffers_;
-    std::vector<VkDeviceMemory> uniformBuffersMemory_;
-    std::vector<void*> uniformBuffersMapped_;
+    /** sub allocates all our buffers and images from a few big blocks */
+    memory::Allocator allocator_;
+    /** all the uploads go through it, no staging buffer per upload */
+    staging::StagingRing stagingRing_;
+    /** records all the init uploads, submitted once */
+    upload::Batch uploadBatch_;
+    /** one vertex buffer and one index buffer for all the meshes */
+    geometrypool::GeometryPool geometryPool_;
+    // the uniforms of all the objects, one region per frame in flight
+    uniformarena::UniformArena uniformArena_;
+    // where the uniforms of the frame and of the model are in the arena this frame
+    uint32_t frameUniformOffset_ = 0;
+    uint32_t modelUniformOffset_ = 0;
+    // its model matrix, pushed with its draws
+    buffer::DrawPushConstants modelDrawConstants_{};
     VkDescriptorPool descriptorPool_;
-    std::vector<VkDescriptorSet> descriptorSets_;
+    // the uniform sets serve all the frames in flight (dynamic offsets)
+    VkDescriptorSet frameDescriptorSet_;
+    VkDescriptorSet objectDescriptorSet_;
+    // the one of the current texture
+    VkDescriptorSet materialDescriptorSet_;
     Camera camera_;
-    VkImage textureImage_;
-    uint32_t mipLevels_;
-    VkDeviceMemory textureImageMemory_;
-    VkImageView textureImageView_;
     VkSampler textureSampler_;
     VkImage depthImage_;
     VkFormat depthFormat_;
-    VkDeviceMemory depthImageMemory_;
+    memory::Allocation depthImageAllocation_;
     VkImageView depthImageView_;
-    std::vector<vertex::Vertex> vertices_;
-    std::vector<uint32_t> indices_;
+    /** the model drawn: the placeholder cube until the loaded one is resident */
+    assetloader::Model model_;
+    /** what is left of model_ after culling the meshlets, for the frame being recorded */
+    std::vector<meshlet::DrawRange> drawRanges_;
+    /** drawRanges_ cut at the submesh boundaries, with their vertex offset */
+    std::vector<indexbuffer::Submesh> draws_;
+    /** parses MODEL_PATH and decodes TEXTURE_PATH on worker threads */
+    assetloader::Loader assetLoader_;
+    /**
+     * GPU side of a model and its texture.
+     * Assigning over it retires the texture in deletionQueue_ (the view first,
+     * in declaration order), the mesh range is retired by retireModelResources
+     */
+    struct ModelResources {
+        geometrypool::MeshRange meshRange;
+        deletion::ImageView textureImageView;
+        deletion::Image textureImage;
+        deletion::Allocation textureImageAllocation;
+        uint32_t mipLevels = 1;
+    };
+    /** the ones drawn */
+    ModelResources modelResources_;
+    /** the loaded model and its resources, while uploadBatch_ copies them */
+    bool isAssetUploadPending_ = false;
+    assetloader::Model pendingModel_;
+    ModelResources pendingResources_;
+    /** resources replaced at runtime, destroyed once the frames in flight are done with them */
+    deletion::Queue deletionQueue_;
     // it will be updated regarding the hardware capabilities
     VkSampleCountFlagBits msaaSampleCount_ = VK_SAMPLE_COUNT_1_BIT;
     VkImage colorImage_;
-    VkDeviceMemory colorImageMemory_;
+    memory::Allocation colorImageAllocation_;
     VkImageView colorImageView_;
 
     void createSurface() {
@@ -252,7 +366,8 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // timeline semaphores are core since 1.2
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         // a lot of information on vk is passed through structs instead of function parameters
         VkInstanceCreateInfo createInfo{};
@@ -313,60 +428,136 @@ private:
             VALIDATION_LAYERS,
             &device_,
             &graphicsQueue_,
-            &presentationQueue_
+            &presentationQueue_,
+            &transferQueue_
         );
+
+        allocator_.init(physicalDevice_, device_);
+        stagingRing_.init(device_, allocator_, STAGING_RING_SIZE);
+        deletionQueue_.init(MAX_FRAMES_IN_FLIGHT);
+        // when both are the same queue, each still signals its values in order
+        graphicsTimeline_.init(device_);
+        transferTimeline_.init(device_);
     }
 
-    void loadModel() {
-        /**
-         * The attrib container holds all of the positions, normals and texture coordinates 
-         * in its attrib.vertices, attrib.normals and attrib.texcoords vectors. 
-         * The shapes container contains all of the separate objects and their faces. 
-         * Each face consists of an array of vertices, and each vertex contains 
-         * the indices of the position, normal and texture coordinate attributes.
-         * OBJ models can also define a material and texture per face, but we will be ignoring those.
-         */
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+    /** uploaded with the rest of the init, drawn from the first frame */
+    void createPlaceholderModel() {
+        model_ = assetloader::createPlaceholderModel(MODEL_SETTINGS, PLACEHOLDER_HALF_EXTENT);
+    }
 
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH)) {
-            throw std::runtime_error(warn + err);
+    /**
+     * the model and the texture are read on worker threads, while we create
+     * the device, the swap chain, the pipeline... and render the first frames
+     */
+    void startAssetLoading() {
+        assetLoader_.start(MODEL_SETTINGS, TEXTURE_PATH);
+    }
+
+    /**
+     * polled once per frame, never blocks:
+     * * the workers are done: the model and the texture are uploaded in a new batch
+     * * the batch completed (drawFrame released it): they replace the placeholders
+     */
+    void updateAssets() {
+        if (uploadBatch_.isPending()) {
+            return;
         }
 
-        // We're going to combine all of the faces in the file into a single model, so just iterate over all of the shapes:
-        for (const auto& shape : shapes) {
-            // The triangulation feature has already made sure that there are three vertices per face,
-            // so we can now directly iterate over the vertices and dump them straight into our vertices vector:
-            for (const auto& index : shape.mesh.indices) {
-                vertex::Vertex vertex{};
-
-                // attrib.vertices array is an array of float values instead of something like glm::vec3
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0], // x
-                    attrib.vertices[3 * index.vertex_index + 1], // y
-                    attrib.vertices[3 * index.vertex_index + 2] // z
-                };
-
-                // Similarly, there are two texture coordinate components per entry.
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0], // u
-                    // for OBJ format 0 means the bottom of the image
-                    // but we've uploaded the image to Vulkan in a top-bottom orientation
-                    // so we flip the vertical axis
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1] // v
-                };
-
-                vertex.color = {1.0f, 1.0f, 1.0f};
-
-                vertices_.push_back(vertex);
-                // For simplicity, we will assume that every vertex is unique for now, hence the simple auto-increment indices.
-                indices_.push_back(indices_.size());
-            }
+        if (isAssetUploadPending_) {
+            switchToLoadedAssets();
+        } else if (assetLoader_.isReady()) {
+            uploadLoadedAssets();
         }
     }
 
+    void uploadLoadedAssets() {
+        // throws again what the workers may have thrown
+        pendingModel_ = assetLoader_.takeModel();
+        texture::DecodedImage image = assetLoader_.takeTexture();
+
+        if (VERBOSE) {
+            std::cout << "model: "
+                << (pendingModel_.indexBuffer.indexType == VK_INDEX_TYPE_UINT16 ? "16" : "32") << " bits indices, "
+                << pendingModel_.indexBuffer.submeshes.size() << " submeshes" << std::endl;
+        }
+
+        beginUploadBatch();
+
+        pendingResources_.meshRange = geometryPool_.upload(
+            uploadBatch_,
+            pendingModel_.getVertexData(),
+            static_cast<uint32_t>(pendingModel_.view.vertexCount),
+            pendingModel_.getIndexData(),
+            static_cast<uint32_t>(pendingModel_.view.indexCount),
+            pendingModel_.indexBuffer.indexType
+        );
+
+        VkImage textureImage;
+        memory::Allocation textureImageAllocation;
+        pendingResources_.mipLevels = texture::createTextureImage(
+            physicalDevice_,
+            device_,
+            allocator_,
+            uploadBatch_,
+            image.pixels.get(),
+            image.width,
+            image.height,
+            VK_SAMPLE_COUNT_1_BIT,
+            textureImage,
+            textureImageAllocation
+        );
+        pendingResources_.textureImage = deletion::Image(deletionQueue_, device_, textureImage);
+        pendingResources_.textureImageAllocation = deletion::Allocation(deletionQueue_, allocator_, textureImageAllocation);
+
+        // the pixels are in the staging ring now, image can go
+        uploadBatch_.submit();
+        isAssetUploadPending_ = true;
+    }
+
+    /**
+     * between two frames, on the render thread: the next command buffer recorded
+     * draws the loaded model, the ones still in flight keep their buffers and descriptor sets
+     */
+    void switchToLoadedAssets() {
+        VkImageView textureImageView;
+        texture::createTextureImageView(
+            device_,
+            pendingResources_.textureImage.get(),
+            textureImageView,
+            pendingResources_.mipLevels
+        );
+        pendingResources_.textureImageView = deletion::ImageView(deletionQueue_, device_, textureImageView);
+
+        // the placeholders are destroyed once the frames in flight are done with them
+        retireModelResources(modelResources_);
+        modelResources_ = std::move(pendingResources_);
+        pendingResources_ = ModelResources{};
+
+        model_ = std::move(pendingModel_);
+        pendingModel_ = assetloader::Model{};
+
+        // a new material set pointing to the new texture view (the pool has room for it):
+        // the old one can't be updated while a frame in flight uses it
+        createMaterialDescriptorSet();
+
+        // the command buffers bind the old set and draw the old ranges
+        commandBufferCache_.invalidate();
+
+        isAssetUploadPending_ = false;
+        if (VERBOSE) {
+            std::cout << "model: resident" << std::endl;
+        }
+    }
+
+    /** no vkDeviceWaitIdle: the frames in flight keep drawing with them */
+    void retireModelResources(ModelResources& resources) {
+        // the range can't be given to another mesh while they read it
+        geometrypool::MeshRange meshRange = resources.meshRange;
+        deletionQueue_.retire([this, meshRange]() mutable { geometryPool_.free(meshRange); });
+
+        resources = ModelResources{};
+    }
+
     void createImageViews() {
         swapchain::createImageViews(
             device_,
@@ -387,22 +578,28 @@ private:
         );
     }
 
-    void createDescriptorSetLayout() {
-        buffer::createDescriptorSetLayout(
+    void createDescriptorSetLayouts() {
+        buffer::createDescriptorSetLayouts(
             device_,
-            descriptorSetLayout_
+            descriptorSetLayouts_
         );
     }
 
     void createGraphicsPipeline() {
+        // computed at compile time from the vertex structs
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = USE_PACKED_VERTICES
+            ? vertex::PackedVertex::Layout::getInputState()
+            : vertex::Vertex::Layout::getInputState();
+
         pipeline::createGraphicsPipeline(
-            VERT_FILE,
+            USE_PACKED_VERTICES ? PACKED_VERT_FILE : VERT_FILE,
             FRAG_FILE,
             device_,
             swapChainExtent_,
             msaaSampleCount_,
             renderPass_,
-            descriptorSetLayout_,
+            descriptorSetLayouts_,
+            vertexInputInfo,
             pipelineLayout_,
             graphicsPipeline_
         );
@@ -433,11 +630,11 @@ private:
 
         vkDestroyImageView(device_, colorImageView_, nullptr);
         vkDestroyImage(device_, colorImage_, nullptr);
-        vkFreeMemory(device_, colorImageMemory_, nullptr);
+        allocator_.free(colorImageAllocation_);
 
         vkDestroyImageView(device_, depthImageView_, nullptr);
         vkDestroyImage(device_, depthImage_, nullptr);
-        vkFreeMemory(device_, depthImageMemory_, nullptr);
+        allocator_.free(depthImageAllocation_);
 
         // Validation Layer error if we do this before destroying the surface
         vkDestroySwapchainKHR(device_, swapChain_, nullptr);
@@ -471,6 +668,9 @@ private:
         }
 
         // don't touch resources while they may be in use
+        // the swap chain images are also used by the presentation engine, which
+        // signals no timeline: unlike the model resources they can't go in deletionQueue_
+        // (resizing is rare, the stall is acceptable here)
         vkDeviceWaitIdle(device_);
 
         cleanupSwapChain();
@@ -480,6 +680,11 @@ private:
         createColorResources();
         createDepthResources();
         createFramebuffers();
+
+        // recorded with the old framebuffers, maybe not the same number of images
+        commandBufferCache_.destroy();
+        drawRecorder_.destroy();
+        createCommandBuffers();
     }
 
     void createCommandPool() {
@@ -497,65 +702,208 @@ private:
         if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool_) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
+
+        // upload command buffers are short lived, recorded once and recycled:
+        // kept apart from the frame command buffers
+        transferTransientPool_.init(device_, queueFamilyIndices.getTransferFamily());
+        graphicsTransientPool_.init(device_, queueFamilyIndices.graphicsFamily.value());
     }
 
-    void createVertexBuffer() {
-        buffer::createBuffer(
-            buffer::Type::Vertex,
-            physicalDevice_,
+    void beginUploadBatch() {
+        device::QueueFamilyIndices queueFamilyIndices = device::findQueueFamilies(physicalDevice_, surface_);
+
+        upload::Queue transfer{};
+        transfer.queue = transferQueue_;
+        transfer.family = queueFamilyIndices.getTransferFamily();
+        transfer.commandPool = &transferTransientPool_;
+        transfer.timeline = &transferTimeline_;
+
+        upload::Queue graphics{};
+        graphics.queue = graphicsQueue_;
+        graphics.family = queueFamilyIndices.graphicsFamily.value();
+        graphics.commandPool = &graphicsTransientPool_;
+        graphics.timeline = &graphicsTimeline_;
+
+        // without a dedicated transfer family, this is a plain single queue batch
+        uploadBatch_.begin(device_, transfer, graphics, stagingRing_);
+    }
+
+    /** the vertex layout of the pool is the one of the pipeline */
+    void createGeometryPool() {
+        geometryPool_.init(
             device_,
-            commandPool_,
-            graphicsQueue_,
-            vertices_,
-            vertexBuffer_,
-            vertexBufferMemory_
+            allocator_,
+            USE_PACKED_VERTICES ? sizeof(vertex::PackedVertex) : sizeof(vertex::Vertex)
+        );
+
+        if (VERBOSE) {
+            std::cout << "geometry pool: "
+                << (geometryPool_.isDirectWrite() ? "written in place (mappable VRAM)" : "uploaded through staging")
+                << std::endl;
+        }
+    }
+
+    void uploadModel() {
+        modelResources_.meshRange = geometryPool_.upload(
+            uploadBatch_,
+            model_.getVertexData(),
+            static_cast<uint32_t>(model_.view.vertexCount),
+            model_.getIndexData(),
+            static_cast<uint32_t>(model_.view.indexCount),
+            model_.indexBuffer.indexType
         );
     }
 
-    void createIndexBuffer() {
-        buffer::createBuffer(
-            buffer::Type::Index,
+    void createUniformArena() {
+        uniformArena_.init(
             physicalDevice_,
             device_,
-            commandPool_,
-            graphicsQueue_,
-            indices_,
-            indexBuffer_,
-            indexBufferMemory_
+            allocator_,
+            MAX_FRAMES_IN_FLIGHT
         );
     }
 
-    void createUniformBuffers() {
-       buffer::createUniformBuffers(
-        physicalDevice_,
-        device_,
-        MAX_FRAMES_IN_FLIGHT,
-        uniformBuffers_,
-        uniformBuffersMemory_,
-        uniformBuffersMapped_
-       );
+    /** depends on the swap chain: created again with it */
+    void createCommandBuffers() {
+        // a cached command buffer draws in the framebuffer of one image
+        uint32_t imageCount = CACHE_COMMAND_BUFFERS ? static_cast<uint32_t>(swapChainImages_.size()) : 1;
+        commandBufferCache_.init(device_, commandPool_, MAX_FRAMES_IN_FLIGHT, imageCount);
+
+        recordedUniformOffsets_.assign(MAX_FRAMES_IN_FLIGHT, {0, 0});
+
+        // executed by the frame command buffers, so the same family
+        // each command buffer has its own secondary ones: they are executed again with it
+        device::QueueFamilyIndices queueFamilyIndices = device::findQueueFamilies(physicalDevice_, surface_);
+        drawRecorder_.init(device_, queueFamilyIndices.graphicsFamily.value(), commandBufferCache_.getSlotCount());
     }
 
-    void createCommandBuffers() {
-        commandBuffers_.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool_;
-        // VK_COMMAND_BUFFER_LEVEL_PRIMARY: Can be submitted to a queue 
-        // for execution, but cannot be called from other command buffers.
-        // VK_COMMAND_BUFFER_LEVEL_SECONDARY: Cannot be submitted directly
-        // but can be called from primary command buffers.
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers_.size());
-
-        if (vkAllocateCommandBuffers(device_, &allocInfo, commandBuffers_.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers!");
+    /**
+     * The inputs of recordCommandBuffer which may change from a frame to the other,
+     * compared to what the command buffers were recorded with.
+     * What changes at known places (swap chain, material set) invalidates the cache there.
+     */
+    void invalidateChangedCommandBuffers() {
+        if (!CACHE_COMMAND_BUFFERS) {
+            commandBufferCache_.invalidate();
+            return;
+        }
+
+        // the same for all the frames: the camera moved, the culling changed the draws
+        if (draws_ != recordedDraws_
+            || modelDrawConstants_.model != recordedDrawConstants_.model
+            || modelDrawConstants_.materialIndex != recordedDrawConstants_.materialIndex
+        ) {
+            recordedDraws_ = draws_;
+            recordedDrawConstants_ = modelDrawConstants_;
+            commandBufferCache_.invalidate();
+        }
+
+        // the arena gives a frame the same offsets while the same uniforms are pushed in the same order
+        std::array<uint32_t, 2> uniformOffsets = {frameUniformOffset_, modelUniformOffset_};
+        if (uniformOffsets != recordedUniformOffsets_[currentFrame_]) {
+            recordedUniformOffsets_[currentFrame_] = uniformOffsets;
+            commandBufferCache_.invalidateFrame(currentFrame_);
+        }
+    }
+
+    /**
+     * the draws [first, last) of draws_ in commandBuffer, primary or secondary:
+     * a secondary command buffer inherits no state, everything is bound again in each
+     */
+    void recordDraws(VkCommandBuffer commandBuffer, size_t first, size_t last) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_);
+
+        // the buffers of the pool: the same for all the meshes
+        VkBuffer vertexBuffers[] = {geometryPool_.getVertexBuffer(modelResources_.meshRange.block)};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        // we can have only one index buffer
+        // 16 bit storage for the indices if the model allows it, see indexbuffer::build
+        // (bound again only for a mesh with the other index type)
+        vkCmdBindIndexBuffer(commandBuffer, geometryPool_.getIndexBuffer(modelResources_.meshRange.block), 0, modelResources_.meshRange.indexType);
+
+        // as we defined viewport and scissor state to be dynamic
+        // we need to set them in the command buffer before the draw command
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(swapChainExtent_.width);
+        viewport.height = static_cast<float>(swapChainExtent_.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = swapChainExtent_;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        // the sets by update frequency (see buffer::SetIndex): the frame and
+        // the material ones stay bound while the object one changes for each object
+        std::array<VkDescriptorSet, 2> frameAndMaterialSets = {frameDescriptorSet_, materialDescriptorSet_};
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout_,
+            buffer::FRAME_SET,
+            static_cast<uint32_t>(frameAndMaterialSets.size()),
+            frameAndMaterialSets.data(),
+            // the material set has no dynamic descriptor
+            1,
+            &frameUniformOffset_
+        );
+
+        // per object: one set for all of them, bound with the offset
+        // of the uniforms of the object in the arena, no descriptor update
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout_,
+            buffer::OBJECT_SET,
+            1,
+            &objectDescriptorSet_,
+            1,
+            &modelUniformOffset_
+        );
+
+        // written in the command buffer: no memory write nor descriptor change per object
+        vkCmdPushConstants(
+            commandBuffer,
+            pipelineLayout_,
+            pipeline::DRAW_PUSH_CONSTANT_STAGES,
+            0,
+            sizeof(modelDrawConstants_),
+            &modelDrawConstants_
+        );
+
+        // only the meshlets which may be visible (see cullModel),
+        // the neighbours in the index buffer merged in one draw
+        // (and cut again where the submeshes change)
+        for (size_t i = first; i < last; i++) {
+            const auto& draw = draws_[i];
+            vkCmdDrawIndexed(
+                commandBuffer,
+                // now index count instead of vertex count as we draw indexed
+                draw.indexCount,
+                // instanceCount: Used for instanced rendering, use 1 if you're not doing that.
+                1,
+                // first index: the draws are relative to the range of the model in the pool
+                modelResources_.meshRange.firstIndex + draw.firstIndex,
+                // offset to add to the indices in the index buffer:
+                // the first vertex of the model in the pool, plus the one of the submesh with 16 bits indices
+                modelResources_.meshRange.vertexOffset + draw.vertexOffset,
+                // firstInstance, we don't use instance.
+                0
+            );
         }
     }
 
-    /** writes the commands we want to execute into a command buffer. */
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    /**
+     * writes the commands we want to execute into a command buffer.
+     * slot: the one of commandBuffer in commandBufferCache_, for its secondary command buffers
+     */
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t slot) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         // none of the flags applicable for us right now
@@ -595,60 +943,30 @@ private:
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        // no secondary command buffer so no VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_);
-
-        VkBuffer vertexBuffers[] = {vertexBuffer_};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-
-        // we can have only one index buffer
-        // we used a 32 bit for storage for the indices
-        // so 32 bit storage for the index buffer
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer_, 0, VK_INDEX_TYPE_UINT32);
-
-        // as we defined viewport and scissor state to be dynamic
-        // we need to set them in the command buffer before the draw command
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(swapChainExtent_.width);
-        viewport.height = static_cast<float>(swapChainExtent_.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = swapChainExtent_;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-        vkCmdBindDescriptorSets(
-            commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout_,
-            0,
-            1,
-            &descriptorSets_[currentFrame_],
-            0,
-            nullptr
-        );
-
-        vkCmdDrawIndexed(
-            commandBuffer,
-            // now index count instead of vertex count as we draw indexed
-            static_cast<uint32_t>(indices_.size()),
-            // instanceCount: Used for instanced rendering, use 1 if you're not doing that.
-            1,
-            // first index
-            0,
-            // offset to add to the indices in the index buffer
-            0,
-            // firstInstance, we don't use instance.
-            0 
-        );
+        // the draws are split in secondary command buffers recorded on the workers,
+        // unless there are too few of them to be worth it
+        if (drawRecorder_.getChunkCount(draws_.size()) > 1) {
+            const std::vector<VkCommandBuffer>& secondaryCommandBuffers = drawRecorder_.record(
+                slot,
+                renderPass_,
+                swapChainFramebuffers_[imageIndex],
+                draws_.size(),
+                [this](VkCommandBuffer secondaryCommandBuffer, size_t first, size_t last) {
+                    recordDraws(secondaryCommandBuffer, first, last);
+                }
+            );
+
+            // the render pass then only executes them, no inline command allowed
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(
+                commandBuffer,
+                static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                secondaryCommandBuffers.data()
+            );
+        } else {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordDraws(commandBuffer, 0, draws_.size());
+        }
 
         vkCmdEndRenderPass(commandBuffer);
 
@@ -661,37 +979,32 @@ private:
     /**
      * We'll need one semaphore to signal that an image has been acquired from the swapchain
      * and is ready for rendering, another one to signal that rendering has finished 
-     * and presentation can happen, and a fence to make sure only one frame is rendering at a time.
+     * and presentation can happen. The swap chain only works with binary semaphores.
+     * To make sure only one frame is rendering at a time, no fence: the point of the
+     * graphics timeline its submission signaled.
      * (1 record on the command buffer for every frame, and we don't want overwriting it while the
      * GPU is using it)
      */
     void createSyncObjects() {
         imageAvailableSemaphores_.resize(MAX_FRAMES_IN_FLIGHT);
         renderFinishedSemaphores_.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences_.resize(MAX_FRAMES_IN_FLIGHT);
+        // no chicken and egg problem like with a fence created signaled:
+        // a default point is already reached, the first wait returns immediately
+        framePoints_.assign(MAX_FRAMES_IN_FLIGHT, timeline::Point{});
 
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        // chicken and egg solvgin by the API:
-        // the first call to vkWaitForFences() returns immediately
-        // since the fence is already signaled.
-        // without it it would block forever
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &imageAvailableSemaphores_[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &renderFinishedSemaphores_[i]) != VK_SUCCESS ||
-            vkCreateFence(device_, &fenceInfo, nullptr, &inFlightFences_[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create semaphores and fences!");
+            vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &renderFinishedSemaphores_[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create semaphores!");
             }
         }
     }
 
     void updateUniformBuffer(uint32_t currentImage) {
-        buffer::UniformBufferObject ubo{};
+        buffer::FrameUniforms ubo{};
 
         // Model matrix
         // Used to transform local (object coordinates) to world coordinates
@@ -699,9 +1012,12 @@ private:
         glm::mat4 cube_model_matrix{glm::mat4(1.0f)};
         // be wary we have an inversion on y axis (see later on the projection matrix)
         auto position = glm::vec3(0.0f,  0.5f, -3.0f);
-        ubo.model = glm::translate(cube_model_matrix, position);
-        ubo.model = glm::rotate(ubo.model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.model = glm::rotate(ubo.model, glm::radians(90.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+        // not in the uniform buffer: given per draw as push constants
+        modelDrawConstants_.model = glm::translate(cube_model_matrix, position);
+        modelDrawConstants_.model = glm::rotate(modelDrawConstants_.model, glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        modelDrawConstants_.model = glm::rotate(modelDrawConstants_.model, glm::radians(90.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+        // one texture for now
+        modelDrawConstants_.materialIndex = 0;
 
         ubo.view = camera_.getUpdatedViewMatrix();
 
@@ -720,14 +1036,65 @@ private:
         // here flip the sign of the scaling factor on th y axis
         ubo.proj[1][1] *= -1;
 
+        buffer::ObjectUniforms modelUniforms{};
+        modelUniforms.positionScale = glm::vec4(model_.positionDequantization.scale, 0.0f);
+        modelUniforms.positionOffset = glm::vec4(model_.positionDequantization.offset, 0.0f);
+
         // all transformations defined, we can copy
         // no staging buffer, and memory already mapped
-        // it is not the most optimal way of doing (see push constants)
-        memcpy(uniformBuffersMapped_[currentImage], &ubo, sizeof(ubo));
+        // the region of this frame is free: its timeline point was waited on
+        uniformArena_.beginFrame(currentImage);
+        frameUniformOffset_ = uniformArena_.push(ubo);
+        modelUniformOffset_ = uniformArena_.push(modelUniforms);
+
+        cullModel(modelDrawConstants_.model, ubo);
+        indexbuffer::splitRanges(model_.indexBuffer.submeshes, drawRanges_, draws_);
+    }
+
+    /**
+     * fills drawRanges_ for the frame, with the matrices given to the shaders:
+     * the level of detail is picked from the distance to the model, the meshlets
+     * are culled only at full resolution (they are built on it)
+     */
+    void cullModel(const glm::mat4& modelMatrix, const buffer::FrameUniforms& ubo) {
+        // the culling data is in object space, the camera is moved there
+        // (the model matrix only translates and rotates: the distances are the same as in world space)
+        glm::vec4 cameraPosition = glm::inverse(modelMatrix) * glm::vec4(camera_.getPosition(), 1.0f);
+        glm::vec3 cameraObject(cameraPosition.x, cameraPosition.y, cameraPosition.z);
+
+        glm::vec3 center = (model_.bounds.min + model_.bounds.max) * 0.5f;
+        float radius = glm::length(model_.bounds.max - model_.bounds.min) * 0.5f;
+        float distance = glm::length(cameraObject - center) - radius;
+
+        // proj[1][1] is 1 / tan(fov / 2), its sign flipped above
+        float pixelsPerUnit = std::abs(ubo.proj[1][1]) * swapChainExtent_.height * 0.5f;
+        size_t level = lod::select(model_.lods, distance, pixelsPerUnit, LOD_PIXEL_ERROR);
+
+        if (level > 0 || model_.meshlets.empty()) {
+            drawRanges_.assign(1, meshlet::DrawRange{model_.lods[level].firstIndex, model_.lods[level].indexCount});
+            return;
+        }
+
+        meshlet::cull(
+            model_.meshlets,
+            ubo.proj * ubo.view * modelMatrix,
+            cameraObject,
+            drawRanges_
+        );
     }
 
     void drawFrame() {
-        vkWaitForFences(device_, 1, &inFlightFences_[currentFrame_], VK_TRUE, UINT64_MAX);
+        timeline::wait(device_, framePoints_[currentFrame_]);
+
+        // what was retired the last time this frame was recorded is not used anymore
+        deletionQueue_.beginFrame(currentFrame_);
+
+        // frees the staging regions and the command buffers of the uploads, without blocking
+        if (uploadBatch_.isPending() && uploadBatch_.isComplete()) {
+            uploadBatch_.wait();
+        }
+
+        updateAssets();
         
 
         uint32_t imageIndex;
@@ -755,36 +1122,42 @@ private:
             throw std::runtime_error("failed to acquire swap chain image!");
         }
 
-        // Only reset the fence if we are submitting work
-        // has we used early return pattern in the lines before
-        // vkQueue needs VK_NULL_HANDLE or unsignaled fence
-        vkResetFences(device_, 1, &inFlightFences_[currentFrame_]);
-
         // record the command buffer
         // make sure the command buffer can be recorded
-        vkResetCommandBuffer(commandBuffers_[currentFrame_], 0);
-        recordCommandBuffer(commandBuffers_[currentFrame_], imageIndex);
-
+        // before recording: the culling needs this frame matrices
         updateUniformBuffer(currentFrame_);
+        invalidateChangedCommandBuffers();
 
-        // submitting the command buffer
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores_[currentFrame_]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers_[currentFrame_];
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores_[currentFrame_]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, inFlightFences_[currentFrame_]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+        // a static scene: submitted again as it is, no CPU recording cost
+        uint32_t slot = commandBufferCache_.getSlot(currentFrame_, imageIndex);
+        VkCommandBuffer commandBuffer = commandBufferCache_.get(slot);
+
+        if (commandBufferCache_.isDirty(slot)) {
+            vkResetCommandBuffer(commandBuffer, 0);
+            recordCommandBuffer(commandBuffer, imageIndex, slot);
+            commandBufferCache_.markRecorded(slot);
         }
 
+        // submitting the command buffer
+        // the binary semaphores of the swap chain: their value is ignored
+        timeline::Wait imageAvailable;
+        imageAvailable.point.semaphore = imageAvailableSemaphores_[currentFrame_];
+        imageAvailable.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+        timeline::Point renderFinished;
+        renderFinished.semaphore = renderFinishedSemaphores_[currentFrame_];
+
+        // and the next value of the graphics timeline, waited on by the CPU
+        // the next time this frame is recorded
+        framePoints_[currentFrame_] = graphicsTimeline_.next();
+
+        timeline::submit(
+            graphicsQueue_,
+            {commandBuffer},
+            {imageAvailable},
+            {renderFinished, framePoints_[currentFrame_]}
+        );
+
         // Presentation
         // The last step of drawing a frame is submitting the result back 
         // to the swap chain to have it eventually show up on the screen
@@ -792,7 +1165,7 @@ private:
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &renderFinished.semaphore;
         VkSwapchainKHR swapChains[] = {swapChain_};
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapChains;
@@ -820,44 +1193,72 @@ private:
     void createDescriptorPool() {
         buffer::createDescriptorPool(
             device_,
-            MAX_FRAMES_IN_FLIGHT,
+            // the set of the placeholder texture, then the one of the loaded texture
+            2,
             descriptorPool_
         );
     }
 
-    void createDescriptorSets() {
-        buffer::createDescriptorSets(
+    void createUniformDescriptorSets() {
+        buffer::createUniformDescriptorSet(
+            device_,
+            uniformArena_.getBuffer(),
+            sizeof(buffer::FrameUniforms),
+            descriptorPool_,
+            descriptorSetLayouts_[buffer::FRAME_SET],
+            frameDescriptorSet_
+        );
+
+        buffer::createUniformDescriptorSet(
             device_,
-            MAX_FRAMES_IN_FLIGHT,
-            uniformBuffers_,
+            uniformArena_.getBuffer(),
+            sizeof(buffer::ObjectUniforms),
             descriptorPool_,
-            descriptorSetLayout_,
-            textureImageView_,
+            descriptorSetLayouts_[buffer::OBJECT_SET],
+            objectDescriptorSet_
+        );
+    }
+
+    void createMaterialDescriptorSet() {
+        buffer::createMaterialDescriptorSet(
+            device_,
+            descriptorPool_,
+            descriptorSetLayouts_[buffer::MATERIAL_SET],
+            modelResources_.textureImageView.get(),
             textureSampler_,
-            descriptorSets_
+            materialDescriptorSet_
         );
     }
 
+    /** the placeholder one, TEXTURE_PATH is loaded in the background */
     void createTextureImage() {
-        mipLevels_ = texture::createTextureImage(
+        VkImage textureImage;
+        memory::Allocation textureImageAllocation;
+        modelResources_.mipLevels = texture::createTextureImage(
             physicalDevice_,
             device_,
-            commandPool_,
-            graphicsQueue_,
-            TEXTURE_PATH,
+            allocator_,
+            uploadBatch_,
+            PLACEHOLDER_PIXELS,
+            2,
+            2,
             VK_SAMPLE_COUNT_1_BIT,
-            textureImage_,
-            textureImageMemory_
+            textureImage,
+            textureImageAllocation
         );
+        modelResources_.textureImage = deletion::Image(deletionQueue_, device_, textureImage);
+        modelResources_.textureImageAllocation = deletion::Allocation(deletionQueue_, allocator_, textureImageAllocation);
     }
 
     void createTextureImageView() {
+        VkImageView textureImageView;
         texture::createTextureImageView(
             device_,
-            textureImage_,
-            textureImageView_,
-            mipLevels_
+            modelResources_.textureImage.get(),
+            textureImageView,
+            modelResources_.mipLevels
         );
+        modelResources_.textureImageView = deletion::ImageView(deletionQueue_, device_, textureImageView);
     }
 
     void createTextureSampler() {
@@ -872,8 +1273,8 @@ private:
         VkFormat colorFormat = swapChainImageFormat_;
 
         texture::bindImageMemory(
-            physicalDevice_,
             device_,
+            allocator_,
             swapChainExtent_.width,
             swapChainExtent_.height,
             1,
@@ -881,9 +1282,10 @@ private:
             colorFormat,
             VK_IMAGE_TILING_OPTIMAL,
             VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            // resolved at the end of the render pass, may never be backed by memory
+            memorytype::TRANSIENT_ATTACHMENT,
             colorImage_,
-            colorImageMemory_
+            colorImageAllocation_
         );
 
         colorImageView_ = image::createImageView(device_, colorImage_, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
@@ -899,8 +1301,8 @@ private:
         );
 
         texture::bindImageMemory(
-            physicalDevice_,
             device_,
+            allocator_,
             swapChainExtent_.width,
             swapChainExtent_.height,
             1,
@@ -908,9 +1310,9 @@ private:
             depthFormat_,
             VK_IMAGE_TILING_OPTIMAL,
             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            memorytype::GPU_ONLY,
             depthImage_,
-            depthImageMemory_
+            depthImageAllocation_
         );
 
         depthImageView_ = image::createImageView(device_, depthImage_, depthFormat_, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
@@ -921,6 +1323,8 @@ private:
 
     
     void initVulkan() {
+        // first: the workers run during the rest of the init
+        startAssetLoading();
         device::printExtensions();
         createInstance();
         setupDebugMessenger();
@@ -930,26 +1334,34 @@ private:
         createSurface();
         pickPhysicalDeviceAndSetMSAASampleCount();
         createLogicalDevice();
-        loadModel();
+        createPlaceholderModel();
         createSwapChain();
         createImageViews();
         createColorResources();
         createDepthResources();
         createRenderPass();
-        createDescriptorSetLayout();
+        createDescriptorSetLayouts();
         createGraphicsPipeline();
         createFramebuffers();
         createCommandPool();
-        createVertexBuffer();
-        createIndexBuffer();
-        createUniformBuffers();
+        // from here the uploads are only recorded
+        beginUploadBatch();
+        createGeometryPool();
+        uploadModel();
+        createUniformArena();
         createDescriptorPool();
         createCommandBuffers();
         createSyncObjects();
         createTextureImage();
+        // one submission for all of them, the GPU works while we finish the init
+        uploadBatch_.submit();
         createTextureImageView();
         createTextureSampler();
-        createDescriptorSets();
+        createUniformDescriptorSets();
+        createMaterialDescriptorSet();
+        // no wait for the uploads here: the frames are submitted after the acquire barriers
+        // on the graphics queue, the batch is released by drawFrame once it completed
+        // the placeholders are drawn until updateAssets switches to the loaded model
     }
 
     void mainLoop() {
@@ -980,6 +1392,11 @@ private:
         }
 
         vkDeviceWaitIdle(device_);
+
+        // the window may be closed before the first frame, or during the model upload
+        if (uploadBatch_.isPending()) {
+            uploadBatch_.wait();
+        }
     }
 
 
@@ -988,16 +1405,15 @@ private:
 
         vkDestroySampler(device_, textureSampler_, nullptr);
 
-        vkDestroyImageView(device_, textureImageView_, nullptr);
-
-        vkDestroyImage(device_, textureImage_, nullptr);
-        vkFreeMemory(device_, textureImageMemory_, nullptr);
+        // the pending ones: uploaded but not switched to yet
+        retireModelResources(modelResources_);
+        retireModelResources(pendingResources_);
 
-        vkDestroyBuffer(device_, vertexBuffer_, nullptr);
-        vkFreeMemory(device_, vertexBufferMemory_, nullptr);
+        // the device is idle (see mainLoop): everything retired can go now
+        deletionQueue_.flush();
 
-        vkDestroyBuffer(device_, indexBuffer_, nullptr);
-        vkFreeMemory(device_, indexBufferMemory_, nullptr);
+        // the ranges of the meshes go with it
+        geometryPool_.destroy(allocator_);
 
         // glfw doesn't provide method for this, so us vk call instead
         vkDestroySurfaceKHR(instance_, surface_, nullptr);
@@ -1006,26 +1422,36 @@ private:
 
         vkDestroyPipeline(device_, graphicsPipeline_, nullptr);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroyBuffer(device_, uniformBuffers_[i], nullptr);
-            vkFreeMemory(device_, uniformBuffersMemory_[i], nullptr);
-        }
+        uniformArena_.destroy(allocator_);
 
         // this will destroy the pool and its descriptor sets
         vkDestroyDescriptorPool(device_, descriptorPool_, nullptr);
 
-        vkDestroyDescriptorSetLayout(device_, descriptorSetLayout_, nullptr);
+        for (VkDescriptorSetLayout descriptorSetLayout : descriptorSetLayouts_) {
+            vkDestroyDescriptorSetLayout(device_, descriptorSetLayout, nullptr);
+        }
 
         vkDestroyPipelineLayout(device_, pipelineLayout_, nullptr);
 
+        commandBufferCache_.destroy();
         vkDestroyCommandPool(device_, commandPool_, nullptr);
+        transferTransientPool_.destroy();
+        graphicsTransientPool_.destroy();
+        drawRecorder_.destroy();
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkDestroySemaphore(device_, renderFinishedSemaphores_[i], nullptr);
             vkDestroySemaphore(device_, imageAvailableSemaphores_[i], nullptr);
-            vkDestroyFence(device_, inFlightFences_[i], nullptr);
         }
 
+        graphicsTimeline_.destroy();
+        transferTimeline_.destroy();
+
+        stagingRing_.destroy(allocator_);
+
+        // all the allocations are freed, we can release the memory blocks
+        allocator_.destroy();
+
         // This is caught by validation layer message if forgotten
         vkDestroyDevice(device_, nullptr);
 
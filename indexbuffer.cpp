@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "indexbuffer.hpp"
+
+namespace indexbuffer {
+
+IndexBuffer build(const uint32_t* indices, size_t indexCount, bool force32) {
+    IndexBuffer indexBuffer;
+
+    if (indexCount % 3 != 0) {
+        throw std::runtime_error("failed to build index buffer, not a triangle list!");
+    }
+
+    if (!force32) {
+        indexBuffer.indexType = VK_INDEX_TYPE_UINT16;
+        indexBuffer.indices16.resize(indexCount);
+
+        bool fits = true;
+        size_t first = 0;
+        uint32_t minVertex = UINT32_MAX;
+        uint32_t maxVertex = 0;
+
+        // the submesh [first, i) is written once the next triangle does not fit in it anymore
+        auto closeSubmesh = [&](size_t end) {
+            for (size_t i = first; i < end; i++) {
+                indexBuffer.indices16[i] = static_cast<uint16_t>(indices[i] - minVertex);
+            }
+            indexBuffer.submeshes.push_back(Submesh{
+                static_cast<uint32_t>(first),
+                static_cast<uint32_t>(end - first),
+                static_cast<int32_t>(minVertex)
+            });
+        };
+
+        for (size_t i = 0; i < indexCount; i += 3) {
+            uint32_t triangleMin = std::min({indices[i], indices[i + 1], indices[i + 2]});
+            uint32_t triangleMax = std::max({indices[i], indices[i + 1], indices[i + 2]});
+
+            if (triangleMax - triangleMin >= MAX_16BIT_VERTEX_SPAN) {
+                fits = false;
+                break;
+            }
+
+            uint32_t newMin = std::min(minVertex, triangleMin);
+            uint32_t newMax = std::max(maxVertex, triangleMax);
+
+            if (i > first && newMax - newMin >= MAX_16BIT_VERTEX_SPAN) {
+                closeSubmesh(i);
+                first = i;
+                newMin = triangleMin;
+                newMax = triangleMax;
+            }
+
+            minVertex = newMin;
+            maxVertex = newMax;
+        }
+
+        if (fits) {
+            if (indexCount > first) {
+                closeSubmesh(indexCount);
+            }
+            return indexBuffer;
+        }
+    }
+
+    indexBuffer.indexType = VK_INDEX_TYPE_UINT32;
+    indexBuffer.indices16.clear();
+    indexBuffer.submeshes.clear();
+    indexBuffer.submeshes.push_back(Submesh{0, static_cast<uint32_t>(indexCount), 0});
+
+    return indexBuffer;
+}
+
+uint32_t getIndexSize(VkIndexType indexType) {
+    return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void splitRanges(
+    const std::vector<Submesh>& submeshes,
+    const std::vector<meshlet::DrawRange>& ranges,
+    std::vector<Submesh>& draws
+) {
+    draws.clear();
+
+    for (const meshlet::DrawRange& range : ranges) {
+        uint32_t end = range.firstIndex + range.indexCount;
+
+        // the last submesh starting at or before the range
+        auto submesh = std::upper_bound(
+            submeshes.begin(),
+            submeshes.end(),
+            range.firstIndex,
+            [](uint32_t index, const Submesh& s) { return index < s.firstIndex; }
+        );
+        if (submesh == submeshes.begin()) {
+            continue;
+        }
+        --submesh;
+
+        uint32_t first = range.firstIndex;
+        for (; submesh != submeshes.end() && first < end; ++submesh) {
+            uint32_t last = std::min(end, submesh->firstIndex + submesh->indexCount);
+            if (last > first) {
+                draws.push_back(Submesh{first, last - first, submesh->vertexOffset});
+            }
+            first = last;
+        }
+    }
+}
+
+}
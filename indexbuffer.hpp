@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "meshlet.hpp"
+
+namespace indexbuffer {
+
+/**
+ * Most meshes have far fewer than 65536 vertices: their indices fit in 16 bits,
+ * half the memory and the bandwidth of the input assembler.
+ * Bigger meshes are split in submeshes, ranges of the index buffer whose vertices
+ * span less than 65536: the indices are stored relative to the first vertex of their
+ * submesh, and vkCmdDrawIndexed adds it back (vertexOffset parameter).
+ * Nothing moves in the vertex buffer: after meshopt::optimizeVertexFetch the vertices are
+ * in order of first use, so the triangles following each other use close vertices.
+ *
+ * The values are 0 to 65535: 0xffff is only special with primitive restart, which we do not use.
+ */
+const uint32_t MAX_16BIT_VERTEX_SPAN = 65536;
+
+/** a range of the index buffer, drawn with its own vertexOffset */
+struct Submesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+};
+
+inline bool operator==(const Submesh& a, const Submesh& b) {
+    return a.firstIndex == b.firstIndex && a.indexCount == b.indexCount && a.vertexOffset == b.vertexOffset;
+}
+
+/** what is uploaded and how to bind and draw it */
+struct IndexBuffer {
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    /** filled for VK_INDEX_TYPE_UINT16, the 32 bits indices are used as they are */
+    std::vector<uint16_t> indices16;
+    /** cover the whole index buffer, in order, whole triangles */
+    std::vector<Submesh> submeshes;
+};
+
+/**
+ * 16 bits indices if possible: starts a new submesh each time the next triangle
+ * would make the vertex span of the current one too big.
+ * Falls back on 32 bits (one submesh, vertexOffset 0) if a single triangle
+ * already spans too many vertices, or if force32 is set.
+ */
+IndexBuffer build(const uint32_t* indices, size_t indexCount, bool force32 = false);
+
+/** size of one index in bytes */
+uint32_t getIndexSize(VkIndexType indexType);
+
+/**
+ * ranges of the index buffer (e.g. after meshlet::cull) to draws:
+ * a range over several submeshes is cut at their boundaries.
+ * draws is cleared then filled, in index order.
+ */
+void splitRanges(
+    const std::vector<Submesh>& submeshes,
+    const std::vector<meshlet::DrawRange>& ranges,
+    std::vector<Submesh>& draws
+);
+
+}
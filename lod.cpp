@@ -0,0 +1,578 @@
+#include <algorithm>
+#include <cmath>
+
+#include "lod.hpp"
+
+namespace lod {
+
+/** borders and seams should not move: their planes count more than the triangle ones */
+static const double BORDER_WEIGHT = 10.0;
+
+/**
+ * error(p) = p^T A p + 2 b.p + c, A symmetric
+ * weight is the sum of the weights of the planes: error / weight is a squared distance
+ */
+struct Quadric {
+    double a00, a11, a22, a01, a02, a12;
+    double b0, b1, b2;
+    double c;
+    double weight;
+};
+
+static void addPlane(Quadric& q, const glm::vec3& normal, float distance, double weight) {
+    double nx = normal.x;
+    double ny = normal.y;
+    double nz = normal.z;
+    double d = distance;
+
+    q.a00 += weight * nx * nx;
+    q.a11 += weight * ny * ny;
+    q.a22 += weight * nz * nz;
+    q.a01 += weight * nx * ny;
+    q.a02 += weight * nx * nz;
+    q.a12 += weight * ny * nz;
+    q.b0 += weight * nx * d;
+    q.b1 += weight * ny * d;
+    q.b2 += weight * nz * d;
+    q.c += weight * d * d;
+    q.weight += weight;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other) {
+    q.a00 += other.a00;
+    q.a11 += other.a11;
+    q.a22 += other.a22;
+    q.a01 += other.a01;
+    q.a02 += other.a02;
+    q.a12 += other.a12;
+    q.b0 += other.b0;
+    q.b1 += other.b1;
+    q.b2 += other.b2;
+    q.c += other.c;
+    q.weight += other.weight;
+}
+
+/** squared distance */
+static double getError(const Quadric& q, const glm::vec3& p) {
+    double x = p.x;
+    double y = p.y;
+    double z = p.z;
+
+    double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+        + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+        + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z)
+        + q.c;
+
+    return q.weight > 0.0 ? std::max(error, 0.0) / q.weight : 0.0;
+}
+
+enum class Kind : uint8_t {
+    // inside the surface: can go anywhere
+    Manifold,
+    // on an open border: only along it
+    Border,
+    // two vertices at the same position (texture seam): both along it
+    Seam,
+    // anything else: never moved
+    Locked
+};
+
+static const uint32_t NONE = UINT32_MAX;
+
+static uint64_t getEdgeKey(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+/** sorted keys of the directed edges, a -> b for each triangle corner */
+static std::vector<uint64_t> getSortedEdges(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap) {
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            edges.push_back(remap.empty() ? getEdgeKey(a, b) : getEdgeKey(remap[a], remap[b]));
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    return edges;
+}
+
+static bool hasEdge(const std::vector<uint64_t>& edges, uint32_t a, uint32_t b) {
+    return std::binary_search(edges.begin(), edges.end(), getEdgeKey(a, b));
+}
+
+/** same position -> same id (the smallest index), and the circular list of the vertices sharing it */
+static void buildPositionRemap(
+    const std::vector<vertex::Vertex>& vertices,
+    std::vector<uint32_t>& remap,
+    std::vector<uint32_t>& wedge
+) {
+    std::vector<uint32_t> order(vertices.size());
+    for (uint32_t v = 0; v < order.size(); v++) {
+        order[v] = v;
+    }
+
+    std::sort(order.begin(), order.end(), [&vertices](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = vertices[a].pos;
+        const glm::vec3& pb = vertices[b].pos;
+        if (pa.x != pb.x) {
+            return pa.x < pb.x;
+        }
+        if (pa.y != pb.y) {
+            return pa.y < pb.y;
+        }
+        if (pa.z != pb.z) {
+            return pa.z < pb.z;
+        }
+        return a < b;
+    });
+
+    remap.assign(vertices.size(), 0);
+    wedge.assign(vertices.size(), 0);
+
+    size_t groupStart = 0;
+    for (size_t i = 0; i <= order.size(); i++) {
+        bool isGroupEnd = i == order.size() || vertices[order[i]].pos != vertices[order[groupStart]].pos;
+        if (!isGroupEnd) {
+            continue;
+        }
+
+        for (size_t j = groupStart; j < i; j++) {
+            remap[order[j]] = order[groupStart];
+            wedge[order[j]] = order[j + 1 < i ? j + 1 : groupStart];
+        }
+        groupStart = i;
+    }
+}
+
+/**
+ * openNext[v] / openPrev[v]: the other end of the edge leaving / entering v with only one triangle,
+ * NONE if there is none, and the vertex is locked if there are several
+ */
+static std::vector<Kind> classifyVertices(
+    const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& remap,
+    const std::vector<uint32_t>& wedge,
+    std::vector<uint32_t>& openNext,
+    std::vector<uint32_t>& openPrev
+) {
+    size_t vertexCount = remap.size();
+
+    std::vector<uint64_t> edges = getSortedEdges(indices, {});
+    std::vector<uint64_t> positionEdges = getSortedEdges(indices, remap);
+
+    openNext.assign(vertexCount, NONE);
+    openPrev.assign(vertexCount, NONE);
+    std::vector<bool> isLocked(vertexCount, false);
+    std::vector<bool> isOnPositionBorder(vertexCount, false);
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+
+            if (!hasEdge(edges, b, a)) {
+                // several open edges around a vertex: it is where borders meet
+                isLocked[a] = isLocked[a] || openNext[a] != NONE;
+                isLocked[b] = isLocked[b] || openPrev[b] != NONE;
+                openNext[a] = b;
+                openPrev[b] = a;
+            }
+
+            if (!hasEdge(positionEdges, remap[b], remap[a])) {
+                isOnPositionBorder[remap[a]] = true;
+                isOnPositionBorder[remap[b]] = true;
+            }
+        }
+    }
+
+    std::vector<Kind> kinds(vertexCount, Kind::Locked);
+
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        bool hasOneOpenLoop = !isLocked[v] && openNext[v] != NONE && openPrev[v] != NONE;
+        bool hasNoOpenEdge = openNext[v] == NONE && openPrev[v] == NONE;
+
+        if (wedge[v] == v) {
+            if (hasNoOpenEdge && !isOnPositionBorder[remap[v]]) {
+                kinds[v] = Kind::Manifold;
+            } else if (hasOneOpenLoop) {
+                kinds[v] = Kind::Border;
+            }
+        } else if (wedge[wedge[v]] == v) {
+            uint32_t other = wedge[v];
+            bool isOtherOneOpenLoop = !isLocked[other] && openNext[other] != NONE && openPrev[other] != NONE;
+
+            // a seam: each side has its own open edges, the surface itself is closed there
+            if (hasOneOpenLoop && isOtherOneOpenLoop && !isOnPositionBorder[remap[v]]) {
+                kinds[v] = Kind::Seam;
+            }
+        }
+    }
+
+    return kinds;
+}
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    /** the other side of a seam, NONE otherwise */
+    uint32_t wedgeFrom;
+    uint32_t wedgeTo;
+    double error;
+};
+
+/** to where the wedge of from has to go for the seam to follow from -> to, NONE if it can't */
+static uint32_t getWedgeTarget(
+    uint32_t from,
+    uint32_t to,
+    const std::vector<uint32_t>& remap,
+    const std::vector<uint32_t>& wedge,
+    const std::vector<uint32_t>& openNext,
+    const std::vector<uint32_t>& openPrev
+) {
+    uint32_t other = wedge[from];
+
+    if (openNext[other] != NONE && remap[openNext[other]] == remap[to]) {
+        return openNext[other];
+    }
+    if (openPrev[other] != NONE && remap[openPrev[other]] == remap[to]) {
+        return openPrev[other];
+    }
+
+    return NONE;
+}
+
+/** fills collapse if from -> to keeps the borders and seams in place */
+static bool canCollapse(
+    uint32_t from,
+    uint32_t to,
+    const std::vector<Kind>& kinds,
+    const std::vector<uint32_t>& remap,
+    const std::vector<uint32_t>& wedge,
+    const std::vector<uint32_t>& openNext,
+    const std::vector<uint32_t>& openPrev,
+    Collapse& collapse
+) {
+    collapse = Collapse{from, to, NONE, NONE, 0.0};
+
+    switch (kinds[from]) {
+        case Kind::Manifold:
+            return true;
+        case Kind::Border:
+            return (to == openNext[from] || to == openPrev[from])
+                && (kinds[to] == Kind::Border || kinds[to] == Kind::Locked);
+        case Kind::Seam:
+            if ((to != openNext[from] && to != openPrev[from])
+                || (kinds[to] != Kind::Seam && kinds[to] != Kind::Locked)) {
+                return false;
+            }
+            collapse.wedgeFrom = wedge[from];
+            collapse.wedgeTo = getWedgeTarget(from, to, remap, wedge, openNext, openPrev);
+            return collapse.wedgeTo != NONE;
+        default:
+            return false;
+    }
+}
+
+/** true if moving the position of from onto to turns a remaining triangle around */
+static bool hasTriangleFlip(
+    uint32_t from,
+    uint32_t to,
+    const std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    const std::vector<uint32_t>& remap,
+    const std::vector<uint32_t>& offsets,
+    const std::vector<uint32_t>& adjacency
+) {
+    uint32_t fromPosition = remap[from];
+    uint32_t toPosition = remap[to];
+    const glm::vec3& target = vertices[to].pos;
+
+    for (uint32_t a = offsets[fromPosition]; a < offsets[fromPosition + 1]; a++) {
+        size_t first = 3 * static_cast<size_t>(adjacency[a]);
+        uint32_t corners[3] = {indices[first], indices[first + 1], indices[first + 2]};
+
+        // the triangles along the collapsed edge disappear
+        if (remap[corners[0]] == toPosition || remap[corners[1]] == toPosition || remap[corners[2]] == toPosition) {
+            continue;
+        }
+
+        glm::vec3 before[3];
+        glm::vec3 after[3];
+        for (size_t k = 0; k < 3; k++) {
+            before[k] = vertices[corners[k]].pos;
+            after[k] = remap[corners[k]] == fromPosition ? target : before[k];
+        }
+
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+        if (glm::dot(normalBefore, normalAfter) <= 0.0f) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<uint32_t> simplify(
+    const std::vector<uint32_t>& inputIndices,
+    const std::vector<vertex::Vertex>& vertices,
+    size_t targetIndexCount,
+    float& error
+) {
+    std::vector<uint32_t> indices = inputIndices;
+    size_t vertexCount = vertices.size();
+    error = 0.0f;
+
+    if (indices.size() <= targetIndexCount) {
+        return indices;
+    }
+
+    std::vector<uint32_t> remap;
+    std::vector<uint32_t> wedge;
+    buildPositionRemap(vertices, remap, wedge);
+
+    std::vector<uint32_t> openNext;
+    std::vector<uint32_t> openPrev;
+    std::vector<Kind> kinds = classifyVertices(indices, remap, wedge, openNext, openPrev);
+
+    // one quadric per position
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& p0 = vertices[indices[i + 0]].pos;
+        const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+        const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f) {
+            continue;
+        }
+        normal /= length;
+        float distance = -glm::dot(normal, p0);
+        // weighted by the area
+        double area = 0.5 * length;
+
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t a = indices[i + k];
+            addPlane(quadrics[remap[a]], normal, distance, area);
+
+            // a plane along the open edges, perpendicular to the triangle
+            uint32_t b = indices[i + (k + 1) % 3];
+            if (openNext[a] == b) {
+                glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+                glm::vec3 edgeNormal = glm::cross(edge, normal);
+                float edgeLength = glm::length(edgeNormal);
+
+                if (edgeLength > 0.0f) {
+                    edgeNormal /= edgeLength;
+                    float edgeDistance = -glm::dot(edgeNormal, vertices[a].pos);
+                    double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+
+                    addPlane(quadrics[remap[a]], edgeNormal, edgeDistance, weight);
+                    addPlane(quadrics[remap[b]], edgeNormal, edgeDistance, weight);
+                }
+            }
+        }
+    }
+
+    double maxError = 0.0;
+    std::vector<uint32_t> collapseTarget(vertexCount);
+    std::vector<bool> isTouched(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<uint64_t> edges;
+
+    // close enough: the last passes would only do a few collapses each
+    size_t stopIndexCount = targetIndexCount + targetIndexCount / 32;
+
+    while (indices.size() > stopIndexCount) {
+        // position -> triangles adjacency, for the flip checks
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (uint32_t index : indices) {
+            offsets[remap[index] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[remap[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // each edge once, and its cheapest allowed direction
+        edges.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t a = indices[i + k];
+                uint32_t b = indices[i + (k + 1) % 3];
+                if (remap[a] != remap[b]) {
+                    edges.push_back(getEdgeKey(std::min(a, b), std::max(a, b)));
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t edge : edges) {
+            uint32_t a = static_cast<uint32_t>(edge >> 32);
+            uint32_t b = static_cast<uint32_t>(edge & 0xffffffff);
+
+            Collapse ab;
+            Collapse ba;
+            // flipping collapses are rejected here and not when applying them:
+            // otherwise their (often tiny) cost would lower the error limit of the pass
+            bool canAB = canCollapse(a, b, kinds, remap, wedge, openNext, openPrev, ab)
+                && !hasTriangleFlip(a, b, indices, vertices, remap, offsets, adjacency);
+            bool canBA = canCollapse(b, a, kinds, remap, wedge, openNext, openPrev, ba)
+                && !hasTriangleFlip(b, a, indices, vertices, remap, offsets, adjacency);
+
+            if (canAB) {
+                ab.error = getError(quadrics[remap[a]], vertices[b].pos);
+            }
+            if (canBA) {
+                ba.error = getError(quadrics[remap[b]], vertices[a].pos);
+            }
+
+            if (canAB && (!canBA || ab.error <= ba.error)) {
+                collapses.push_back(ab);
+            } else if (canBA) {
+                collapses.push_back(ba);
+            }
+        }
+
+        if (collapses.empty()) {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+            return x.error < y.error;
+        });
+
+        // a collapse removes ~2 triangles: do not go (much) below the target in one pass
+        size_t budget = std::max<size_t>(1, (indices.size() - targetIndexCount) / 6);
+        size_t collapseCount = 0;
+
+        // many of the cheapest collapses are skipped (they touch a position already moved):
+        // the pass goes a bit over the error of the last collapse it would do otherwise,
+        // but not further, the expensive ones wait for the next passes with updated costs
+        double passErrorLimit = budget < collapses.size() ? 1.5 * collapses[budget].error : collapses.back().error;
+
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            collapseTarget[v] = v;
+        }
+        std::fill(isTouched.begin(), isTouched.end(), false);
+
+        for (const Collapse& collapse : collapses) {
+            if (collapseCount >= budget || collapse.error > passErrorLimit) {
+                break;
+            }
+
+            // one collapse per position and per pass: the costs and flip checks stay valid
+            if (isTouched[remap[collapse.from]] || isTouched[remap[collapse.to]]) {
+                continue;
+            }
+
+            collapseTarget[collapse.from] = collapse.to;
+            if (collapse.wedgeFrom != NONE) {
+                collapseTarget[collapse.wedgeFrom] = collapse.wedgeTo;
+            }
+
+            addQuadric(quadrics[remap[collapse.to]], quadrics[remap[collapse.from]]);
+            isTouched[remap[collapse.from]] = true;
+            isTouched[remap[collapse.to]] = true;
+            maxError = std::max(maxError, collapse.error);
+            collapseCount++;
+        }
+
+        if (collapseCount == 0) {
+            break;
+        }
+
+        // rewrite the triangles, the ones which lost their area are gone
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t a = collapseTarget[indices[i + 0]];
+            uint32_t b = collapseTarget[indices[i + 1]];
+            uint32_t c = collapseTarget[indices[i + 2]];
+
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+                continue;
+            }
+
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+
+    error = static_cast<float>(std::sqrt(maxError));
+
+    return indices;
+}
+
+std::vector<Lod> buildChain(
+    std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    uint32_t levelCount,
+    float ratio
+) {
+    std::vector<Lod> lods;
+    lods.push_back(Lod{0, static_cast<uint32_t>(indices.size()), 0.0f});
+
+    std::vector<uint32_t> fullResolution = indices;
+    size_t previousCount = fullResolution.size();
+
+    for (uint32_t level = 1; level <= levelCount; level++) {
+        size_t target = static_cast<size_t>(previousCount * ratio) / 3 * 3;
+
+        float error;
+        std::vector<uint32_t> simplified = simplify(fullResolution, vertices, target, error);
+
+        // less than 10% fewer triangles than the previous level: not worth a level
+        if (simplified.empty() || simplified.size() > previousCount * 9 / 10) {
+            break;
+        }
+
+        lods.push_back(Lod{static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), error});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        previousCount = simplified.size();
+    }
+
+    return lods;
+}
+
+size_t select(
+    const std::vector<Lod>& lods,
+    float distance,
+    float pixelsPerUnit,
+    float maxPixelError
+) {
+    // inside the object: the full resolution
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    size_t selected = 0;
+
+    // the errors grow with the level
+    for (size_t i = 1; i < lods.size(); i++) {
+        float pixelError = lods[i].error * pixelsPerUnit / distance;
+        if (pixelError > maxPixelError) {
+            break;
+        }
+        selected = i;
+    }
+
+    return selected;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+
+namespace lod {
+
+/**
+ * One level of detail: a range of the index buffer.
+ * All the levels share the vertex buffer (the simplification only removes triangles
+ * and moves none of the vertices), their indices follow each other in one index buffer,
+ * from the full resolution one.
+ *
+ * Plain data, written as is in the mesh cache.
+ */
+struct Lod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    /** distance between this level and the full resolution surface, in object space units */
+    float error;
+};
+
+static_assert(sizeof(Lod) == 12, "Lod is written as is in the mesh cache");
+
+/**
+ * Quadric error metric simplification (Garland and Heckbert, "Surface Simplification
+ * Using Quadric Error Metrics", 1997), with edge collapses onto an existing vertex.
+ *
+ * Each position accumulates the planes of its triangles (and planes along the borders
+ * and texture seams so they do not move), the cost of moving it is its distance
+ * to these planes. The cheapest collapses are done first, in passes, until
+ * targetIndexCount is reached or nothing can be collapsed anymore.
+ *
+ * Border and seam vertices only slide along their border or seam, vertices where
+ * more than two texture islands meet are kept.
+ *
+ * error: set to the error of the result, see Lod::error
+ */
+std::vector<uint32_t> simplify(
+    const std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    size_t targetIndexCount,
+    float& error
+);
+
+/**
+ * Appends up to levelCount levels to indices, each with ratio times the triangles
+ * of the previous one (each simplified from the full resolution, the first range).
+ * Stops early when the simplification stalls.
+ * Returns all the levels, the full resolution one first.
+ */
+std::vector<Lod> buildChain(
+    std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    uint32_t levelCount,
+    float ratio
+);
+
+/**
+ * The coarsest level whose error, projected on the screen, stays under maxPixelError.
+ *
+ * distance: from the camera to the object (e.g. to its bounding sphere)
+ * pixelsPerUnit: size in pixels of 1 unit at a distance of 1,
+ * viewport height / (2 * tan(vertical fov / 2))
+ */
+size_t select(
+    const std::vector<Lod>& lods,
+    float distance,
+    float pixelsPerUnit,
+    float maxPixelError
+);
+
+}
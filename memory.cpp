@@ -0,0 +1,212 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "memory.hpp"
+
+namespace memory {
+
+void FreeList::reset(VkDeviceSize size) {
+    ranges_.assign(1, Range{0, size});
+}
+
+bool FreeList::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    // first fit: the list is short as adjacent ranges are merged
+    for (size_t i = 0; i < ranges_.size(); i++) {
+        Range range = ranges_[i];
+        VkDeviceSize alignedOffset = alignUp(range.offset, alignment);
+        VkDeviceSize rangeEnd = range.offset + range.size;
+
+        if (alignedOffset + size > rangeEnd) {
+            continue;
+        }
+
+        ranges_.erase(ranges_.begin() + i);
+
+        // what is left after the allocation goes back to the free list
+        // padding in front first so the list stays sorted
+        VkDeviceSize allocationEnd = alignedOffset + size;
+        if (allocationEnd < rangeEnd) {
+            ranges_.insert(ranges_.begin() + i, {allocationEnd, rangeEnd - allocationEnd});
+        }
+        if (alignedOffset > range.offset) {
+            ranges_.insert(ranges_.begin() + i, {range.offset, alignedOffset - range.offset});
+        }
+
+        offset = alignedOffset;
+        return true;
+    }
+
+    return false;
+}
+
+void FreeList::free(VkDeviceSize offset, VkDeviceSize size) {
+    if (size == 0) {
+        return;
+    }
+
+    // keep the list sorted and merge with the neighbours
+    auto it = std::lower_bound(
+        ranges_.begin(),
+        ranges_.end(),
+        offset,
+        [](const Range& range, VkDeviceSize rangeOffset) { return range.offset < rangeOffset; }
+    );
+    it = ranges_.insert(it, Range{offset, size});
+
+    auto next = it + 1;
+    if (next != ranges_.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        ranges_.erase(next);
+    }
+
+    if (it != ranges_.begin()) {
+        auto previous = it - 1;
+        if (previous->offset + previous->size == it->offset) {
+            previous->size += it->size;
+            ranges_.erase(it);
+        }
+    }
+}
+
+void Allocator::init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice logicalDevice,
+    VkDeviceSize blockSize
+) {
+    physicalDevice_ = physicalDevice;
+    logicalDevice_ = logicalDevice;
+    blockSize_ = blockSize;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice_, &properties);
+    bufferImageGranularity_ = properties.limits.bufferImageGranularity;
+
+    // the memory properties are read once here, not on every allocation
+    memoryTypes_.init(physicalDevice_);
+}
+
+void Allocator::destroy() {
+    for (auto& block : blocks_) {
+        // unmapping is implicit when freeing, but be explicit
+        if (block.mapped != nullptr) {
+            vkUnmapMemory(logicalDevice_, block.memory);
+        }
+        vkFreeMemory(logicalDevice_, block.memory, nullptr);
+    }
+
+    blocks_.clear();
+}
+
+VkDeviceMemory Allocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** pMapped) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory deviceMemory;
+    if (vkAllocateMemory(logicalDevice_, &allocInfo, nullptr, &deviceMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+
+    *pMapped = nullptr;
+    // map host visible memory once and for all, mapping has a cost
+    if (memoryTypes_.getFlags(memoryTypeIndex) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        vkMapMemory(logicalDevice_, deviceMemory, 0, VK_WHOLE_SIZE, 0, pMapped);
+    }
+
+    return deviceMemory;
+}
+
+Allocation Allocator::allocate(
+    const VkMemoryRequirements& memRequirements,
+    const memorytype::Request& memoryRequest,
+    ResourceKind kind,
+    bool dedicated
+) {
+    Allocation allocation{};
+    allocation.size = memRequirements.size;
+    allocation.memoryTypeIndex = memoryTypes_.find(memRequirements.memoryTypeBits, memoryRequest);
+
+    // blocks are capped to a fraction of the heap, some heaps are tiny
+    // (e.g. the 256MB device local + host visible one without resizable BAR)
+    VkDeviceSize blockSize = std::min(blockSize_, memoryTypes_.getHeapSize(allocation.memoryTypeIndex) / 8);
+
+    if (dedicated || memRequirements.size > blockSize / 2) {
+        allocation.memory = allocateDeviceMemory(memRequirements.size, allocation.memoryTypeIndex, &allocation.mapped);
+        allocation.offset = 0;
+        allocation.blockIndex = DEDICATED_BLOCK;
+        dedicatedCount_++;
+
+        return allocation;
+    }
+
+    // without granularity constraint everything can live in the same block
+    if (bufferImageGranularity_ <= 1) {
+        kind = Linear;
+    }
+
+    for (uint32_t i = 0; i < blocks_.size(); i++) {
+        Block& block = blocks_[i];
+
+        if (block.memoryTypeIndex != allocation.memoryTypeIndex || block.kind != kind) {
+            continue;
+        }
+
+        if (block.freeList.allocate(memRequirements.size, memRequirements.alignment, allocation.offset)) {
+            allocation.memory = block.memory;
+            allocation.blockIndex = i;
+            allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+
+            return allocation;
+        }
+    }
+
+    // no room in the existing blocks, create a new one
+    Block block{};
+    block.size = blockSize;
+    block.memoryTypeIndex = allocation.memoryTypeIndex;
+    block.kind = kind;
+    block.memory = allocateDeviceMemory(blockSize, allocation.memoryTypeIndex, &block.mapped);
+    block.freeList.reset(blockSize);
+
+    blocks_.push_back(block);
+
+    Block& newBlock = blocks_.back();
+    // can't fail, the request is at most half a block
+    newBlock.freeList.allocate(memRequirements.size, memRequirements.alignment, allocation.offset);
+    allocation.memory = newBlock.memory;
+    allocation.blockIndex = static_cast<uint32_t>(blocks_.size() - 1);
+    allocation.mapped = newBlock.mapped ? static_cast<char*>(newBlock.mapped) + allocation.offset : nullptr;
+
+    return allocation;
+}
+
+void Allocator::free(Allocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (allocation.blockIndex == DEDICATED_BLOCK) {
+        vkFreeMemory(logicalDevice_, allocation.memory, nullptr);
+        dedicatedCount_--;
+        allocation = Allocation{};
+        return;
+    }
+
+    blocks_[allocation.blockIndex].freeList.free(allocation.offset, allocation.size);
+
+    // Empty blocks are kept for the next allocations:
+    // resources are often destroyed and created again (e.g. swap chain recreation)
+
+    allocation = Allocation{};
+}
+
+uint32_t Allocator::getDeviceAllocationCount() const {
+    return dedicatedCount_ + static_cast<uint32_t>(blocks_.size());
+}
+
+const memorytype::Selector& Allocator::getMemoryTypes() const {
+    return memoryTypes_;
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "memorytype.hpp"
+
+namespace memory {
+
+/**
+ * As the README (and the tutorial) warns, calling vkAllocateMemory for every
+ * buffer and image quickly hits maxMemoryAllocationCount (as low as 4096)
+ * and costs a driver round trip each time.
+ *
+ * The allocator grabs big blocks of device memory per memory type and
+ * hands out sub ranges of them, using the offset parameter of
+ * vkBindBufferMemory / vkBindImageMemory.
+ */
+const VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+/** blockIndex value of an allocation owning its own VkDeviceMemory */
+const uint32_t DEDICATED_BLOCK = UINT32_MAX;
+
+/**
+ * value rounded up to a multiple of alignment.
+ * Vulkan alignments are powers of two, but not every caller's (e.g. the wrap of staging::StagingRing)
+ */
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * bufferImageGranularity is a page like granularity: linear resources (buffers,
+ * linearly tiled images) and optimal tiled images must not share such a "page"
+ * in the same VkDeviceMemory, or they may alias each other.
+ * We keep them in separate blocks so we never have to care about it.
+ */
+enum ResourceKind {
+    Linear,
+    Optimal
+};
+
+/**
+ * The free space of a linear range (a block of device memory, a buffer of a pool):
+ * a list of free ranges sorted by offset, allocated first fit and merged with
+ * their neighbours when freed, so it stays short.
+ */
+class FreeList {
+public:
+    /** everything free, [0, size) */
+    void reset(VkDeviceSize size);
+
+    /** false if no free range fits size at alignment */
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+    /** a range given by allocate() */
+    void free(VkDeviceSize offset, VkDeviceSize size);
+
+private:
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    // sorted by offset, adjacent ranges are always merged
+    std::vector<Range> ranges_;
+};
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    /**
+     * host visible blocks are mapped once for their whole lifetime ("persistent mapping"),
+     * this already points at offset. nullptr for device only memory.
+     * Note: a VkDeviceMemory can only be mapped once, so never vkMapMemory an allocation
+     */
+    void* mapped = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockIndex = DEDICATED_BLOCK;
+};
+
+class Allocator {
+public:
+    void init(
+        VkPhysicalDevice physicalDevice,
+        VkDevice logicalDevice,
+        VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE
+    );
+
+    /** free all the blocks, every allocation must have been freed before */
+    void destroy();
+
+    /**
+     * Sub allocate from a block of the best memory type for memoryRequest (see memorytype::Selector),
+     * creating the block if needed. Plain VkMemoryPropertyFlags are required flags.
+     * Requests bigger than half a block, or explicitly dedicated ones (render targets are
+     * good candidates) get their own vkAllocateMemory.
+     */
+    Allocation allocate(
+        const VkMemoryRequirements& memRequirements,
+        const memorytype::Request& memoryRequest,
+        ResourceKind kind,
+        bool dedicated = false
+    );
+
+    void free(Allocation& allocation);
+
+    /** number of live vkAllocateMemory, to compare with maxMemoryAllocationCount */
+    uint32_t getDeviceAllocationCount() const;
+
+    /** e.g. to know if an allocation is host coherent */
+    const memorytype::Selector& getMemoryTypes() const;
+
+private:
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        ResourceKind kind = Linear;
+        void* mapped = nullptr;
+        FreeList freeList;
+    };
+
+    VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    VkDeviceSize blockSize_ = DEFAULT_BLOCK_SIZE;
+    VkDeviceSize bufferImageGranularity_ = 1;
+    memorytype::Selector memoryTypes_;
+    std::vector<Block> blocks_;
+    uint32_t dedicatedCount_ = 0;
+
+    VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** pMapped);
+};
+
+}
@@ -0,0 +1,85 @@
+#include <bitset>
+#include <stdexcept>
+
+#include "memorytype.hpp"
+
+namespace memorytype {
+
+static int countFlags(VkMemoryPropertyFlags flags) {
+    return static_cast<int>(std::bitset<32>(flags).count());
+}
+
+void Selector::init(VkPhysicalDevice physicalDevice) {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties_);
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    cache_.clear();
+}
+
+uint32_t Selector::find(uint32_t typeFilter, const Request& request) const {
+    // held for the scoring too: a few dozen types at most, and a miss happens once per request
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+
+    for (const CacheEntry& entry : cache_) {
+        if (entry.typeFilter == typeFilter
+            && entry.request.required == request.required
+            && entry.request.preferred == request.preferred
+            && entry.request.avoided == request.avoided) {
+            return entry.memoryTypeIndex;
+        }
+    }
+
+    uint32_t best = UINT32_MAX;
+    int bestScore = 0;
+    VkDeviceSize bestHeapSize = 0;
+
+    for (uint32_t i = 0; i < memProperties_.memoryTypeCount; i++) {
+        VkMemoryPropertyFlags flags = memProperties_.memoryTypes[i].propertyFlags;
+
+        if (!(typeFilter & (1 << i)) || (flags & request.required) != request.required) {
+            continue;
+        }
+
+        int score = countFlags(flags & request.preferred) - countFlags(flags & request.avoided);
+        VkDeviceSize heapSize = getHeapSize(i);
+
+        // on a tie the bigger heap, then the lower index
+        // (the drivers list the types from the fastest)
+        if (best == UINT32_MAX || score > bestScore || (score == bestScore && heapSize > bestHeapSize)) {
+            best = i;
+            bestScore = score;
+            bestHeapSize = heapSize;
+        }
+    }
+
+    if (best == UINT32_MAX) {
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    cache_.push_back(CacheEntry{typeFilter, request, best});
+    return best;
+}
+
+VkMemoryPropertyFlags Selector::getFlags(uint32_t memoryTypeIndex) const {
+    return memProperties_.memoryTypes[memoryTypeIndex].propertyFlags;
+}
+
+VkDeviceSize Selector::getHeapSize(uint32_t memoryTypeIndex) const {
+    return memProperties_.memoryHeaps[memProperties_.memoryTypes[memoryTypeIndex].heapIndex].size;
+}
+
+bool Selector::hasLargeMappableDeviceMemory() const {
+    const VkMemoryPropertyFlags mappableDeviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+        | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for (uint32_t i = 0; i < memProperties_.memoryTypeCount; i++) {
+        if ((getFlags(i) & mappableDeviceLocal) == mappableDeviceLocal && getHeapSize(i) > BAR_WINDOW_SIZE) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
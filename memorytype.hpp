@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+namespace memorytype {
+
+/** the size of the host visible VRAM window without resizable BAR */
+const VkDeviceSize BAR_WINDOW_SIZE = 256 * 1024 * 1024;
+
+/**
+ * What a resource wants from its memory:
+ * the required flags must all be there, then the types with the most preferred
+ * and the fewest avoided flags win, then the ones on the biggest heap.
+ */
+struct Request {
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags avoided = 0;
+
+    Request() = default;
+
+    /** with only required flags, the way buffer::findMemoryType takes them */
+    Request(
+        VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0,
+        VkMemoryPropertyFlags avoided = 0
+    ) : required(required), preferred(preferred), avoided(avoided) {}
+};
+
+/** only read by the GPU, filled by copies: the host visible VRAM is kept for the direct writes */
+const Request GPU_ONLY{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT};
+
+/** render targets which may never leave the tile memory of mobile GPUs (transient attachments) */
+const Request TRANSIENT_ATTACHMENT{
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+};
+
+/** written by the CPU, read once by a copy (staging): system memory, VRAM is for the GPU */
+const Request UPLOAD{
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    0,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+};
+
+/** written by the CPU every frame, read by the shaders: in VRAM when the CPU can write there */
+const Request DYNAMIC{
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    0
+};
+
+/** written by the GPU, read by the CPU: uncached reads are very slow */
+const Request READBACK{
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+    VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    0
+};
+
+/**
+ * buffer::findMemoryType asks the driver for the memory properties on every call
+ * and returns the first type with the flags, whatever its heap. The selector reads
+ * them once per device, scores the types (see Request) and remembers its answers:
+ * the allocator asks the same few questions over and over.
+ * find() can be called from several threads, the answers are shared behind a mutex.
+ */
+class Selector {
+public:
+    void init(VkPhysicalDevice physicalDevice);
+
+    /** the best type among typeFilter (VkMemoryRequirements::memoryTypeBits), throws if none fits */
+    uint32_t find(uint32_t typeFilter, const Request& request) const;
+
+    VkMemoryPropertyFlags getFlags(uint32_t memoryTypeIndex) const;
+    VkDeviceSize getHeapSize(uint32_t memoryTypeIndex) const;
+
+    /**
+     * a device local, host visible and coherent type bigger than the BAR window:
+     * resizable BAR or unified memory, the CPU can write the GPU resources directly
+     * instead of going through a staging buffer
+     */
+    bool hasLargeMappableDeviceMemory() const;
+
+private:
+    struct CacheEntry {
+        uint32_t typeFilter;
+        Request request;
+        uint32_t memoryTypeIndex;
+    };
+
+    VkPhysicalDeviceMemoryProperties memProperties_{};
+    /** filled by find(), const for the callers: guarded by cacheMutex_ */
+    mutable std::mutex cacheMutex_;
+    /** a handful of distinct requests, a linear search is enough */
+    mutable std::vector<CacheEntry> cache_;
+};
+
+}
@@ -0,0 +1,173 @@
+#include <cstring>
+#include <utility>
+#include <limits>
+
+#include "mesh.hpp"
+
+namespace mesh {
+
+static uint32_t floatBits(float value) {
+    // 0.0 and -0.0 are equal but have different bits, they must hash the same
+    if (value == 0.0f) {
+        return 0;
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint64_t hashVertex(const vertex::Vertex& vertex) {
+    const float values[] = {
+        vertex.pos.x, vertex.pos.y, vertex.pos.z,
+        vertex.color.x, vertex.color.y, vertex.color.z,
+        vertex.texCoord.x, vertex.texCoord.y
+    };
+
+    // FNV-1a on 32 bits words, then a final mix (murmur3 finalizer)
+    // as we only keep the low bits for the slot
+    uint64_t hash = 14695981039346656037ull;
+    for (float value : values) {
+        hash ^= floatBits(value);
+        hash *= 1099511628211ull;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+static bool isSameVertex(const vertex::Vertex& a, const vertex::Vertex& b) {
+    return a.pos == b.pos && a.color == b.color && a.texCoord == b.texCoord;
+}
+
+MeshBuilder::MeshBuilder(size_t expectedVertexCount) {
+    size_t slotCount = 64;
+    // keep the load factor under 1/2, probes stay short
+    while (slotCount < expectedVertexCount * 2) {
+        slotCount *= 2;
+    }
+
+    mesh_.vertices.reserve(expectedVertexCount);
+    rehash(slotCount);
+}
+
+void MeshBuilder::rehash(size_t slotCount) {
+    slots_.assign(slotCount, EMPTY_SLOT);
+    mask_ = slotCount - 1;
+
+    for (uint32_t i = 0; i < mesh_.vertices.size(); i++) {
+        size_t slot = hashVertex(mesh_.vertices[i]) & mask_;
+        while (slots_[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & mask_;
+        }
+        slots_[slot] = i;
+    }
+}
+
+uint32_t MeshBuilder::findOrInsert(const vertex::Vertex& vertex) {
+    size_t slot = hashVertex(vertex) & mask_;
+
+    while (slots_[slot] != EMPTY_SLOT) {
+        uint32_t index = slots_[slot];
+        if (isSameVertex(mesh_.vertices[index], vertex)) {
+            return index;
+        }
+        slot = (slot + 1) & mask_;
+    }
+
+    uint32_t index = static_cast<uint32_t>(mesh_.vertices.size());
+    mesh_.vertices.push_back(vertex);
+    slots_[slot] = index;
+
+    if (mesh_.vertices.size() * 2 > slots_.size()) {
+        rehash(slots_.size() * 2);
+    }
+
+    return index;
+}
+
+void MeshBuilder::addVertex(const vertex::Vertex& vertex) {
+    mesh_.indices.push_back(findOrInsert(vertex));
+}
+
+size_t MeshBuilder::getVertexCount() const {
+    return mesh_.vertices.size();
+}
+
+size_t MeshBuilder::getIndexCount() const {
+    return mesh_.indices.size();
+}
+
+Mesh MeshBuilder::build() {
+    Mesh mesh = std::move(mesh_);
+    mesh_ = Mesh{};
+    rehash(64);
+
+    return mesh;
+}
+
+MeshView makeView(const Mesh& mesh) {
+    MeshView view{};
+    view.vertices = mesh.vertices.data();
+    view.vertexCount = mesh.vertices.size();
+    view.indices = mesh.indices.data();
+    view.indexCount = mesh.indices.size();
+
+    return view;
+}
+
+Bounds computeBounds(const vertex::Vertex* vertices, size_t vertexCount) {
+    Bounds bounds{};
+
+    if (vertexCount == 0) {
+        return bounds;
+    }
+
+    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        bounds.min = glm::min(bounds.min, vertices[i].pos);
+        bounds.max = glm::max(bounds.max, vertices[i].pos);
+    }
+
+    return bounds;
+}
+
+Mesh createCube(float halfExtent) {
+    Mesh mesh;
+
+    for (int axis = 0; axis < 3; axis++) {
+        for (float sign : {1.0f, -1.0f}) {
+            // normal, and two axes in the face with u x v = normal:
+            // the corners in the order (-u -v) (+u -v) (+u +v) (-u +v) turn counter clockwise around it
+            glm::vec3 normal(0.0f);
+            normal[axis] = sign;
+            glm::vec3 u(0.0f);
+            u[(axis + 1) % 3] = 1.0f;
+            glm::vec3 v = glm::cross(normal, u);
+
+            const glm::vec2 corners[4] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+            auto first = static_cast<uint32_t>(mesh.vertices.size());
+
+            for (const glm::vec2& corner : corners) {
+                vertex::Vertex vertex{};
+                vertex.pos = (normal + corner.x * u + corner.y * v) * halfExtent;
+                vertex.color = glm::vec3(1.0f);
+                vertex.texCoord = (corner + glm::vec2(1.0f)) * 0.5f;
+                mesh.vertices.push_back(vertex);
+            }
+
+            for (uint32_t index : {0u, 1u, 2u, 0u, 2u, 3u}) {
+                mesh.indices.push_back(first + index);
+            }
+        }
+    }
+
+    return mesh;
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+
+namespace mesh {
+
+struct Mesh {
+    std::vector<vertex::Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+/** non owning view of a mesh, e.g. on a Mesh or on a memory mapped file */
+struct MeshView {
+    const vertex::Vertex* vertices = nullptr;
+    size_t vertexCount = 0;
+    const uint32_t* indices = nullptr;
+    size_t indexCount = 0;
+};
+
+MeshView makeView(const Mesh& mesh);
+
+/** axis aligned bounding box of the positions */
+struct Bounds {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+Bounds computeBounds(const vertex::Vertex* vertices, size_t vertexCount);
+
+/**
+ * axis aligned cube centered on the origin, 4 vertices per face (each face has
+ * the whole texture), counter clockwise seen from outside, white vertex color:
+ * e.g. placeholder geometry while the real mesh is loading
+ */
+Mesh createCube(float halfExtent);
+
+/**
+ * OBJ faces reference a position, a texture coordinate (and a normal) each by their own index,
+ * so the same (position, uv, color) tuple comes back for every triangle sharing the corner.
+ * Emitting one vertex per face corner gives an identity index buffer and
+ * a vertex buffer several times bigger than needed.
+ *
+ * The builder welds identical vertices: each new vertex is looked up in a hash table
+ * and only its index is emitted if it was already seen. Besides the smaller buffers,
+ * the GPU post-transform cache can only skip the vertex shader for repeated indices.
+ *
+ * The table is an open addressing one (linear probing, power of two size) storing
+ * indices in the vertices array: no node allocation like std::unordered_map,
+ * and probes are contiguous in memory.
+ */
+class MeshBuilder {
+public:
+    /** expectedVertexCount: number of unique vertices if known, avoids rehashing */
+    explicit MeshBuilder(size_t expectedVertexCount = 0);
+
+    /** appends the index of vertex, adding it to the vertices only if it was not already seen */
+    void addVertex(const vertex::Vertex& vertex);
+
+    size_t getVertexCount() const;
+    size_t getIndexCount() const;
+
+    /** the builder is empty afterwards */
+    Mesh build();
+
+private:
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    Mesh mesh_;
+    // index in mesh_.vertices or EMPTY_SLOT
+    std::vector<uint32_t> slots_;
+    size_t mask_ = 0;
+
+    void rehash(size_t slotCount);
+    uint32_t findOrInsert(const vertex::Vertex& vertex);
+};
+
+}
@@ -0,0 +1,329 @@
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "meshcache.hpp"
+#include "memory.hpp"
+
+namespace meshcache {
+
+static void fillLayout(Header& header, const VertexLayout& vertexLayout) {
+    if (vertexLayout.attributeCount > MAX_ATTRIBUTES) {
+        throw std::runtime_error("too many vertex attributes for the mesh cache!");
+    }
+
+    header.vertexStride = vertexLayout.binding.stride;
+    header.attributeCount = vertexLayout.attributeCount;
+
+    for (uint32_t i = 0; i < header.attributeCount; i++) {
+        header.attributes[i].location = vertexLayout.attributes[i].location;
+        header.attributes[i].format = vertexLayout.attributes[i].format;
+        header.attributes[i].offset = vertexLayout.attributes[i].offset;
+    }
+}
+
+uint64_t hashSource(const char* sourcePath, uint64_t importKey) {
+    struct stat sourceStat;
+    if (stat(sourcePath, &sourceStat) != 0) {
+        return 0;
+    }
+
+    // hashing the content would mean reading the whole source,
+    // what we want to avoid: size and modification time are enough to detect an edit
+    const uint64_t values[] = {
+        static_cast<uint64_t>(sourceStat.st_size),
+        static_cast<uint64_t>(sourceStat.st_mtim.tv_sec),
+        static_cast<uint64_t>(sourceStat.st_mtim.tv_nsec),
+        VERSION,
+        importKey
+    };
+
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t value : values) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+void write(
+    const char* cachePath,
+    const char* sourcePath,
+    const VertexBlob& vertices,
+    const IndexBlob& indices,
+    const mesh::Bounds& bounds,
+    const std::vector<meshlet::Meshlet>& meshlets,
+    const std::vector<lod::Lod>& lods,
+    uint64_t importKey
+) {
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sourceHash = hashSource(sourcePath, importKey);
+    fillLayout(header, vertices.layout);
+    header.indexSize = indexbuffer::getIndexSize(indices.indexType);
+    header.vertexCount = vertices.count;
+    header.vertexOffset = memory::alignUp(sizeof(Header), BLOB_ALIGNMENT);
+    header.indexCount = indices.count;
+    header.indexOffset = memory::alignUp(header.vertexOffset + vertices.count * header.vertexStride, BLOB_ALIGNMENT);
+    header.submeshCount = indices.submeshCount;
+    header.submeshOffset = memory::alignUp(header.indexOffset + indices.count * header.indexSize, BLOB_ALIGNMENT);
+    header.meshletCount = meshlets.size();
+    header.meshletOffset = memory::alignUp(
+        header.submeshOffset + indices.submeshCount * sizeof(indexbuffer::Submesh),
+        BLOB_ALIGNMENT
+    );
+    header.lodCount = lods.size();
+    header.lodOffset = memory::alignUp(header.meshletOffset + meshlets.size() * sizeof(meshlet::Meshlet), BLOB_ALIGNMENT);
+
+    memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+    memcpy(header.positionScale, &vertices.positionDequantization.scale, sizeof(header.positionScale));
+    memcpy(header.positionOffset, &vertices.positionDequantization.offset, sizeof(header.positionOffset));
+
+    std::string tmpPath = std::string(cachePath) + ".tmp";
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open mesh cache for writing!");
+    }
+
+    const char zeros[BLOB_ALIGNMENT] = {};
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(zeros, header.vertexOffset - sizeof(header));
+    file.write(static_cast<const char*>(vertices.data), vertices.count * header.vertexStride);
+    file.write(zeros, header.indexOffset - (header.vertexOffset + vertices.count * header.vertexStride));
+    file.write(static_cast<const char*>(indices.data), indices.count * header.indexSize);
+    file.write(zeros, header.submeshOffset - (header.indexOffset + indices.count * header.indexSize));
+    file.write(reinterpret_cast<const char*>(indices.submeshes), indices.submeshCount * sizeof(indexbuffer::Submesh));
+    file.write(zeros, header.meshletOffset - (header.submeshOffset + indices.submeshCount * sizeof(indexbuffer::Submesh)));
+    file.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(meshlet::Meshlet));
+    file.write(zeros, header.lodOffset - (header.meshletOffset + meshlets.size() * sizeof(meshlet::Meshlet)));
+    file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(lod::Lod));
+    file.close();
+
+    if (!file) {
+        throw std::runtime_error("failed to write mesh cache!");
+    }
+
+    if (std::rename(tmpPath.c_str(), cachePath) != 0) {
+        throw std::runtime_error("failed to write mesh cache!");
+    }
+}
+
+MappedMesh::~MappedMesh() {
+    close();
+}
+
+bool MappedMesh::open(
+    const char* cachePath,
+    const char* sourcePath,
+    const VertexLayout& vertexLayout,
+    uint64_t importKey
+) {
+    close();
+
+    uint64_t sourceHash = hashSource(sourcePath, importKey);
+
+    int fd = ::open(cachePath, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat cacheStat;
+    if (fstat(fd, &cacheStat) != 0 || static_cast<size_t>(cacheStat.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<size_t>(cacheStat.st_size);
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference on the file
+    ::close(fd);
+
+    if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        size_ = 0;
+        return false;
+    }
+
+    if (!isValid(sourceHash, vertexLayout)) {
+        close();
+        return false;
+    }
+
+    // we are going to read it all right away for the upload
+    madvise(data_, size_, MADV_WILLNEED);
+
+    return true;
+}
+
+/** count elements from offset fit in size, without overflowing on a corrupted header */
+static bool isBlobInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) {
+    return offset <= size && count <= (size - offset) / elementSize;
+}
+
+/** the range [first, first + count) is in [0, indexCount) */
+static bool isRangeInIndices(uint64_t first, uint64_t count, uint64_t indexCount) {
+    return first <= indexCount && count <= indexCount - first;
+}
+
+bool MappedMesh::isValid(uint64_t sourceHash, const VertexLayout& vertexLayout) const {
+    const Header& header = getHeader();
+
+    if (header.magic != MAGIC || header.version != VERSION) {
+        return false;
+    }
+
+    // the source changed since. Without source (e.g. only the cache is shipped) trust the cache
+    if (sourceHash != 0 && header.sourceHash != sourceHash) {
+        return false;
+    }
+
+    // written with another vertex layout (packed or not), or the vertex struct changed since
+    Header current{};
+    fillLayout(current, vertexLayout);
+    if (header.vertexStride != current.vertexStride
+        || header.attributeCount != current.attributeCount
+        || memcmp(header.attributes, current.attributes, sizeof(current.attributes)) != 0) {
+        return false;
+    }
+
+    if (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) {
+        return false;
+    }
+
+    // truncated file
+    if (!isBlobInFile(header.vertexOffset, header.vertexCount, header.vertexStride, size_)
+        || !isBlobInFile(header.indexOffset, header.indexCount, header.indexSize, size_)
+        || !isBlobInFile(header.submeshOffset, header.submeshCount, sizeof(indexbuffer::Submesh), size_)
+        || !isBlobInFile(header.meshletOffset, header.meshletCount, sizeof(meshlet::Meshlet), size_)
+        || !isBlobInFile(header.lodOffset, header.lodCount, sizeof(lod::Lod), size_)) {
+        return false;
+    }
+
+    // the full resolution level is always there: the renderer draws lods[0]
+    if (header.lodCount < 1) {
+        return false;
+    }
+
+    // the ranges are used as they are by the draws, they must stay in the index buffer
+    const lod::Lod* lods = getLods();
+    for (uint64_t i = 0; i < header.lodCount; i++) {
+        if (!isRangeInIndices(lods[i].firstIndex, lods[i].indexCount, header.indexCount)) {
+            return false;
+        }
+    }
+
+    const indexbuffer::Submesh* submeshes = getSubmeshes();
+    for (uint64_t i = 0; i < header.submeshCount; i++) {
+        if (!isRangeInIndices(submeshes[i].firstIndex, submeshes[i].indexCount, header.indexCount)) {
+            return false;
+        }
+    }
+
+    const meshlet::Meshlet* meshlets = getMeshlets();
+    for (uint64_t i = 0; i < header.meshletCount; i++) {
+        if (!isRangeInIndices(meshlets[i].firstIndex, meshlets[i].indexCount, header.indexCount)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MappedMesh::close() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedMesh::isOpen() const {
+    return data_ != nullptr;
+}
+
+const Header& MappedMesh::getHeader() const {
+    return *static_cast<const Header*>(data_);
+}
+
+const void* MappedMesh::getVertexData() const {
+    // the blobs are aligned in the file, and the mapping is page aligned
+    return static_cast<const char*>(data_) + getHeader().vertexOffset;
+}
+
+size_t MappedMesh::getVertexCount() const {
+    return getHeader().vertexCount;
+}
+
+quantize::PositionDequantization MappedMesh::getPositionDequantization() const {
+    const Header& header = getHeader();
+
+    quantize::PositionDequantization dequantization{};
+    memcpy(&dequantization.scale, header.positionScale, sizeof(header.positionScale));
+    memcpy(&dequantization.offset, header.positionOffset, sizeof(header.positionOffset));
+
+    return dequantization;
+}
+
+const void* MappedMesh::getIndexData() const {
+    return static_cast<const char*>(data_) + getHeader().indexOffset;
+}
+
+size_t MappedMesh::getIndexCount() const {
+    return getHeader().indexCount;
+}
+
+VkIndexType MappedMesh::getIndexType() const {
+    return getHeader().indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+const indexbuffer::Submesh* MappedMesh::getSubmeshes() const {
+    const char* bytes = static_cast<const char*>(data_);
+    return reinterpret_cast<const indexbuffer::Submesh*>(bytes + getHeader().submeshOffset);
+}
+
+size_t MappedMesh::getSubmeshCount() const {
+    return getHeader().submeshCount;
+}
+
+mesh::Bounds MappedMesh::getBounds() const {
+    const Header& header = getHeader();
+
+    mesh::Bounds bounds{};
+    memcpy(&bounds.min, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(&bounds.max, header.boundsMax, sizeof(header.boundsMax));
+
+    return bounds;
+}
+
+const meshlet::Meshlet* MappedMesh::getMeshlets() const {
+    const char* bytes = static_cast<const char*>(data_);
+    return reinterpret_cast<const meshlet::Meshlet*>(bytes + getHeader().meshletOffset);
+}
+
+size_t MappedMesh::getMeshletCount() const {
+    return getHeader().meshletCount;
+}
+
+const lod::Lod* MappedMesh::getLods() const {
+    const char* bytes = static_cast<const char*>(data_);
+    return reinterpret_cast<const lod::Lod*>(bytes + getHeader().lodOffset);
+}
+
+size_t MappedMesh::getLodCount() const {
+    return getHeader().lodCount;
+}
+
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <vector>
+
+#include "mesh.hpp"
+#include "meshlet.hpp"
+#include "lod.hpp"
+#include "quantize.hpp"
+#include "indexbuffer.hpp"
+
+namespace meshcache {
+
+/**
+ * Parsing the OBJ text on every start is slow (seconds for big models).
+ * After the first load the mesh is written in a binary file laid out exactly like
+ * the GPU buffers, and the next runs only have to mmap it: the vertex and index blobs
+ * are then copied straight from the mapping into the staging memory.
+ * The vertices are stored as uploaded (e.g. already quantized), with what the shader
+ * needs to read them: nothing is converted again on the next runs.
+ *
+ * File layout:
+ * * Header
+ * * vertex blob, in the layout of the header, aligned on BLOB_ALIGNMENT
+ * * index blob, as uploaded (16 bits indices relative to their submesh, or 32 bits),
+ *   aligned on BLOB_ALIGNMENT
+ * * submesh blob (indexbuffer::Submesh array), aligned on BLOB_ALIGNMENT
+ * * meshlet blob (meshlet::Meshlet array, may be empty), aligned on BLOB_ALIGNMENT
+ * * level of detail blob (lod::Lod array, may be empty), aligned on BLOB_ALIGNMENT
+ *   the ranges point in the index blob, which holds all the levels
+ */
+const uint32_t MAGIC = 0x434d4b56; // "VKMC" in little endian
+/** to be bumped when the format or the mesh processing changes */
+const uint32_t VERSION = 6;
+const uint32_t MAX_ATTRIBUTES = 8;
+const uint64_t BLOB_ALIGNMENT = 64;
+
+/** mirrors VkVertexInputAttributeDescription, without the binding */
+struct AttributeDescriptor {
+    uint32_t location;
+    // VkFormat
+    uint32_t format;
+    uint32_t offset;
+};
+
+/** the layout of a vertex blob: the one the pipeline reads the vertex buffer with */
+struct VertexLayout {
+    VkVertexInputBindingDescription binding;
+    const VkVertexInputAttributeDescription* attributes;
+    uint32_t attributeCount;
+};
+
+/** V: a vertex struct with a single stream Layout (vertex::Vertex, vertex::PackedVertex) */
+template <class V>
+VertexLayout getVertexLayout() {
+    static_assert(V::Layout::bindingCount == 1, "the cache stores a single vertex stream");
+
+    return VertexLayout{
+        V::Layout::bindingDescriptions[0],
+        V::Layout::attributeDescriptions.data(),
+        static_cast<uint32_t>(V::Layout::attributeCount)
+    };
+}
+
+/** the vertex buffer as uploaded */
+struct VertexBlob {
+    const void* data = nullptr;
+    size_t count = 0;
+    VertexLayout layout{};
+    /** identity if the positions are not quantized */
+    quantize::PositionDequantization positionDequantization{glm::vec3(1.0f), glm::vec3(0.0f)};
+};
+
+/** the index buffer as uploaded, and the submeshes to draw it (see indexbuffer::build) */
+struct IndexBlob {
+    const void* data = nullptr;
+    size_t count = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    const indexbuffer::Submesh* submeshes = nullptr;
+    size_t submeshCount = 0;
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    /**
+     * size and modification time of the source file, and the import key:
+     * the cache is stale if one of them changed
+     */
+    uint64_t sourceHash;
+    /**
+     * the vertex layout the blob was written with: part of the key,
+     * the cache is stale if the caller asks for another one
+     */
+    uint32_t vertexStride;
+    uint32_t attributeCount;
+    AttributeDescriptor attributes[MAX_ATTRIBUTES];
+    /** in bytes, 2 for VK_INDEX_TYPE_UINT16, 4 for VK_INDEX_TYPE_UINT32 */
+    uint32_t indexSize;
+    uint32_t padding;
+    uint64_t vertexCount;
+    uint64_t vertexOffset;
+    uint64_t indexCount;
+    uint64_t indexOffset;
+    uint64_t submeshCount;
+    uint64_t submeshOffset;
+    uint64_t meshletCount;
+    uint64_t meshletOffset;
+    uint64_t lodCount;
+    uint64_t lodOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    /** position = stored position * scale + offset */
+    float positionScale[3];
+    float positionOffset[3];
+};
+
+/**
+ * returns 0 if the source file can't be found
+ * importKey: whatever else changes the output of the import (e.g. meshopt::hashOptions)
+ */
+uint64_t hashSource(const char* sourcePath, uint64_t importKey = 0);
+
+/**
+ * written in a temporary file then renamed, a crash never leaves a half written cache
+ * bounds: of the float positions, before any quantization
+ */
+void write(
+    const char* cachePath,
+    const char* sourcePath,
+    const VertexBlob& vertices,
+    const IndexBlob& indices,
+    const mesh::Bounds& bounds,
+    const std::vector<meshlet::Meshlet>& meshlets,
+    const std::vector<lod::Lod>& lods,
+    uint64_t importKey = 0
+);
+
+/** read only mapping of a cache file */
+class MappedMesh {
+public:
+    MappedMesh() = default;
+    ~MappedMesh();
+    MappedMesh(const MappedMesh&) = delete;
+    MappedMesh& operator=(const MappedMesh&) = delete;
+
+    /**
+     * returns false if there is no cache, or if it is invalid or stale
+     * (including a vertex blob in another layout than vertexLayout):
+     * the source has to be parsed again
+     */
+    bool open(
+        const char* cachePath,
+        const char* sourcePath,
+        const VertexLayout& vertexLayout,
+        uint64_t importKey = 0
+    );
+
+    /** the views are invalid afterwards */
+    void close();
+
+    bool isOpen() const;
+
+    /** points in the mapping, in the layout given to open() */
+    const void* getVertexData() const;
+    size_t getVertexCount() const;
+    quantize::PositionDequantization getPositionDequantization() const;
+    /** points in the mapping, getIndexCount() indices of getIndexType() */
+    const void* getIndexData() const;
+    size_t getIndexCount() const;
+    VkIndexType getIndexType() const;
+    /** points in the mapping */
+    const indexbuffer::Submesh* getSubmeshes() const;
+    size_t getSubmeshCount() const;
+    mesh::Bounds getBounds() const;
+    const meshlet::Meshlet* getMeshlets() const;
+    size_t getMeshletCount() const;
+    const lod::Lod* getLods() const;
+    size_t getLodCount() const;
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+
+    const Header& getHeader() const;
+    bool isValid(uint64_t sourceHash, const VertexLayout& vertexLayout) const;
+};
+
+}
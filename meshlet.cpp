@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "meshlet.hpp"
+
+namespace meshlet {
+
+static glm::vec3 getTriangleNormal(const std::vector<uint32_t>& indices, const std::vector<vertex::Vertex>& vertices, size_t first) {
+    const glm::vec3& a = vertices[indices[first + 0]].pos;
+    const glm::vec3& b = vertices[indices[first + 1]].pos;
+    const glm::vec3& c = vertices[indices[first + 2]].pos;
+
+    return glm::cross(b - a, c - a);
+}
+
+static void computeBounds(
+    Meshlet& meshlet,
+    const std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices
+) {
+    uint32_t end = meshlet.firstIndex + meshlet.indexCount;
+
+    // sphere around the box: not the smallest one, but close and cheap
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+
+    for (uint32_t i = meshlet.firstIndex; i < end; i++) {
+        min = glm::min(min, vertices[indices[i]].pos);
+        max = glm::max(max, vertices[indices[i]].pos);
+    }
+
+    meshlet.center = (min + max) * 0.5f;
+    meshlet.radius = 0.0f;
+
+    for (uint32_t i = meshlet.firstIndex; i < end; i++) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[indices[i]].pos - meshlet.center));
+    }
+
+    // cone axis: average of the unit normals, the degenerate triangles do not count
+    glm::vec3 axis(0.0f);
+
+    for (uint32_t i = meshlet.firstIndex; i < end; i += 3) {
+        glm::vec3 normal = getTriangleNormal(indices, vertices, i);
+        float length = glm::length(normal);
+
+        if (length > 0.0f) {
+            axis += normal / length;
+        }
+    }
+
+    // never culled unless proven otherwise
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    float axisLength = glm::length(axis);
+    if (axisLength <= 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+
+    for (uint32_t i = meshlet.firstIndex; i < end; i += 3) {
+        glm::vec3 normal = getTriangleNormal(indices, vertices, i);
+        float length = glm::length(normal);
+
+        if (length > 0.0f) {
+            minDot = std::min(minDot, glm::dot(axis, normal / length));
+        }
+    }
+
+    // half angle of 90 degrees or more: some triangles always face the camera
+    if (minDot <= 0.0f) {
+        return;
+    }
+
+    meshlet.coneAxis = axis;
+    // cos(angle) -> sin(angle)
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+/** the same id for the vertices at the same position: the smallest of their indices */
+static std::vector<uint32_t> getPositionIds(const std::vector<vertex::Vertex>& vertices) {
+    std::vector<uint32_t> order(vertices.size());
+    for (uint32_t v = 0; v < order.size(); v++) {
+        order[v] = v;
+    }
+
+    auto isLess = [&vertices](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = vertices[a].pos;
+        const glm::vec3& pb = vertices[b].pos;
+        if (pa.x != pb.x) {
+            return pa.x < pb.x;
+        }
+        if (pa.y != pb.y) {
+            return pa.y < pb.y;
+        }
+        if (pa.z != pb.z) {
+            return pa.z < pb.z;
+        }
+        return a < b;
+    };
+    std::sort(order.begin(), order.end(), isLess);
+
+    std::vector<uint32_t> ids(vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        bool isSamePosition = i > 0 && vertices[order[i]].pos == vertices[order[i - 1]].pos;
+        ids[order[i]] = isSamePosition ? ids[order[i - 1]] : order[i];
+    }
+
+    return ids;
+}
+
+std::vector<Meshlet> build(
+    std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    uint32_t maxVertices,
+    uint32_t maxTriangles
+) {
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = vertices.size();
+
+    std::vector<Meshlet> meshlets;
+
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    // the vertices are split along the texture seams: neighbours are found by position,
+    // else each UV island would end its meshlet
+    std::vector<uint32_t> positionIds = getPositionIds(vertices);
+
+    // position -> triangles adjacency, in one array (offsets are prefix sums of the counts)
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        offsets[positionIds[index] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            adjacency[fill[positionIds[indices[3 * t + k]]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<bool> isEmitted(triangleCount, false);
+    // meshlet number + 1 of the last meshlet using the vertex
+    std::vector<uint32_t> vertexMeshlet(vertexCount, 0);
+    // triangles sharing a vertex with the current meshlet (may hold emitted ones)
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    for (size_t seed = 0; seed < triangleCount; seed++) {
+        if (isEmitted[seed]) {
+            continue;
+        }
+
+        Meshlet meshlet{};
+        meshlet.firstIndex = static_cast<uint32_t>(output.size());
+        uint32_t meshletMark = static_cast<uint32_t>(meshlets.size()) + 1;
+        uint32_t meshletVertexCount = 0;
+        uint32_t meshletTriangleCount = 0;
+        candidates.clear();
+
+        int64_t next = static_cast<int64_t>(seed);
+
+        while (next >= 0) {
+            uint32_t t = static_cast<uint32_t>(next);
+
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t vertex = indices[3 * t + k];
+                output.push_back(vertex);
+
+                if (vertexMeshlet[vertex] != meshletMark) {
+                    vertexMeshlet[vertex] = meshletMark;
+                    meshletVertexCount++;
+
+                    uint32_t position = positionIds[vertex];
+                    for (uint32_t a = offsets[position]; a < offsets[position + 1]; a++) {
+                        if (!isEmitted[adjacency[a]]) {
+                            candidates.push_back(adjacency[a]);
+                        }
+                    }
+                }
+            }
+
+            isEmitted[t] = true;
+            meshletTriangleCount++;
+            next = -1;
+
+            if (meshletTriangleCount == maxTriangles) {
+                break;
+            }
+
+            // the neighbour adding the fewest vertices, the oldest one on ties
+            uint32_t bestNewVertices = 4;
+            size_t kept = 0;
+
+            for (size_t c = 0; c < candidates.size(); c++) {
+                uint32_t candidate = candidates[c];
+                if (isEmitted[candidate]) {
+                    continue;
+                }
+                candidates[kept++] = candidate;
+
+                uint32_t newVertices = 0;
+                for (size_t k = 0; k < 3; k++) {
+                    newVertices += vertexMeshlet[indices[3 * candidate + k]] != meshletMark;
+                }
+
+                if (newVertices < bestNewVertices && meshletVertexCount + newVertices <= maxVertices) {
+                    bestNewVertices = newVertices;
+                    next = candidate;
+                }
+            }
+            candidates.resize(kept);
+        }
+
+        meshlet.indexCount = static_cast<uint32_t>(output.size()) - meshlet.firstIndex;
+        meshlets.push_back(meshlet);
+    }
+
+    indices.swap(output);
+
+    for (Meshlet& meshlet : meshlets) {
+        computeBounds(meshlet, indices, vertices);
+    }
+
+    return meshlets;
+}
+
+/**
+ * Gribb and Hartmann: the planes are combinations of the rows of the matrix,
+ * a point is inside if -w <= x <= w, -w <= y <= w and 0 <= z <= w (Vulkan depth range)
+ */
+static void extractFrustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    // glm is column major: m[column][row]
+    auto row = [&m](int r) {
+        return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    };
+
+    glm::vec4 x = row(0);
+    glm::vec4 y = row(1);
+    glm::vec4 z = row(2);
+    glm::vec4 w = row(3);
+
+    planes[0] = w + x;
+    planes[1] = w - x;
+    planes[2] = w + y;
+    planes[3] = w - y;
+    planes[4] = z;
+    planes[5] = w - z;
+
+    // normalized so the distance to the plane can be compared to the radius
+    for (int i = 0; i < 6; i++) {
+        float length = glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+        if (length > 0.0f) {
+            planes[i] = planes[i] * (1.0f / length);
+        }
+    }
+}
+
+void cull(
+    const std::vector<Meshlet>& meshlets,
+    const glm::mat4& modelViewProjection,
+    const glm::vec3& cameraPosition,
+    std::vector<DrawRange>& ranges
+) {
+    ranges.clear();
+
+    glm::vec4 planes[6];
+    extractFrustumPlanes(modelViewProjection, planes);
+
+    for (const Meshlet& meshlet : meshlets) {
+        bool isOutside = false;
+        for (int i = 0; i < 6 && !isOutside; i++) {
+            float distance = planes[i].x * meshlet.center.x
+                + planes[i].y * meshlet.center.y
+                + planes[i].z * meshlet.center.z
+                + planes[i].w;
+            isOutside = distance < -meshlet.radius;
+        }
+
+        if (isOutside) {
+            continue;
+        }
+
+        // seen from anywhere in the sphere, every normal points away from the camera
+        glm::vec3 toCenter = meshlet.center - cameraPosition;
+        if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) {
+            continue;
+        }
+
+        if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex) {
+            ranges.back().indexCount += meshlet.indexCount;
+        } else {
+            ranges.push_back({meshlet.firstIndex, meshlet.indexCount});
+        }
+    }
+}
+
+}
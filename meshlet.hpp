@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+
+namespace meshlet {
+
+/** 64 vertices and 124 triangles: the usual sizes for mesh shaders (NVIDIA recommendation) */
+const uint32_t MAX_VERTICES = 64;
+const uint32_t MAX_TRIANGLES = 124;
+
+/**
+ * A small cluster of neighbouring triangles, contiguous in the index buffer:
+ * drawn by vkCmdDrawIndexed(indexCount, 1, firstIndex, 0, 0), or skipped as a whole
+ * when the culling data says none of its triangles can be visible.
+ *
+ * Plain data, written as is in the mesh cache.
+ */
+struct Meshlet {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    /** bounding sphere, in object space */
+    glm::vec3 center;
+    float radius;
+    /**
+     * normal cone: all the triangle normals are within the cone of this axis,
+     * coneCutoff is the sine of its half angle (1 when the cone is too wide to cull anything)
+     */
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+static_assert(sizeof(Meshlet) == 40, "Meshlet is written as is in the mesh cache");
+
+/**
+ * Greedy clustering: a meshlet starts at the first triangle not emitted yet
+ * (so the previous order, e.g. meshopt::optimizeOverdraw, is mostly kept) and grows with
+ * the neighbouring triangles adding the fewest new vertices, until a limit is reached
+ * or there is no neighbour left.
+ * The triangles are reordered so each meshlet is a range of indices.
+ */
+std::vector<Meshlet> build(
+    std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    uint32_t maxVertices = MAX_VERTICES,
+    uint32_t maxTriangles = MAX_TRIANGLES
+);
+
+/** what is left to draw: index ranges */
+struct DrawRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+/**
+ * CPU culling, for the renderer to skip the meshlets:
+ * * outside the frustum (bounding sphere against the 6 planes of modelViewProjection)
+ * * facing away from the camera (normal cone, counter clockwise front faces)
+ *
+ * cameraPosition is in object space (inverse of the model matrix applied to it).
+ * The visible meshlets that follow each other in the index buffer are merged
+ * in one range: ranges is cleared then filled, in index order.
+ */
+void cull(
+    const std::vector<Meshlet>& meshlets,
+    const glm::mat4& modelViewProjection,
+    const glm::vec3& cameraPosition,
+    std::vector<DrawRange>& ranges
+);
+
+}
@@ -0,0 +1,552 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "meshopt.hpp"
+
+namespace meshopt {
+
+CacheStats analyzeVertexCache(
+    const std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    uint32_t cacheSize
+) {
+    CacheStats stats{};
+
+    if (indices.empty()) {
+        return stats;
+    }
+
+    // FIFO: a vertex is in the cache if it entered it less than cacheSize misses ago
+    // (hits do not change the FIFO order)
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> isUsed(vertexCount, false);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    size_t usedCount = 0;
+
+    for (uint32_t index : indices) {
+        if (time - cacheTime[index] > cacheSize) {
+            cacheTime[index] = time++;
+            misses++;
+        }
+
+        if (!isUsed[index]) {
+            isUsed[index] = true;
+            usedCount++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / usedCount;
+
+    return stats;
+}
+
+/** one of the vertices just emitted, the best one to fan around next, or -1 */
+static int64_t getNextVertex(
+    const std::vector<uint32_t>& candidates,
+    const std::vector<uint32_t>& liveTriangles,
+    const std::vector<uint32_t>& cacheTime,
+    uint32_t time,
+    uint32_t cacheSize
+) {
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+
+    for (uint32_t vertex : candidates) {
+        if (liveTriangles[vertex] == 0) {
+            continue;
+        }
+
+        // each remaining triangle adds at most 2 new vertices to the cache:
+        // if the vertex is still in it after that, prefer the oldest one (it will be evicted soon)
+        int64_t priority = 0;
+        if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+            priority = time - cacheTime[vertex];
+        }
+
+        if (priority > bestPriority) {
+            bestPriority = priority;
+            best = vertex;
+        }
+    }
+
+    return best;
+}
+
+void optimizeVertexCache(
+    std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    uint32_t cacheSize
+) {
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // vertex -> triangles adjacency, in one array (offsets are prefix sums of the counts)
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) {
+        liveTriangles[index]++;
+    }
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            adjacency[fill[indices[3 * t + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> isEmitted(triangleCount, false);
+    // vertices of the emitted triangles, to restart from when stuck
+    std::vector<uint32_t> deadEndStack;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    // next vertex in input order, when the dead end stack is empty too
+    size_t cursor = 0;
+    int64_t fanning = 0;
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (isEmitted[t]) {
+                continue;
+            }
+
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t vertex = indices[3 * t + k];
+
+                output.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+
+            isEmitted[t] = true;
+        }
+
+        fanning = getNextVertex(candidates, liveTriangles, cacheTime, time, cacheSize);
+
+        if (fanning >= 0) {
+            continue;
+        }
+
+        // dead end: the most recently emitted vertex with triangles left (likely in cache)
+        while (!deadEndStack.empty()) {
+            uint32_t vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+
+            if (liveTriangles[vertex] > 0) {
+                fanning = vertex;
+                break;
+            }
+        }
+
+        // or any vertex with triangles left (a new connected component)
+        while (fanning < 0 && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                fanning = static_cast<int64_t>(cursor);
+            }
+            cursor++;
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(
+    std::vector<vertex::Vertex>& vertices,
+    std::vector<uint32_t>& indices
+) {
+    const uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<vertex::Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices.swap(reordered);
+}
+
+struct Cluster {
+    uint32_t firstTriangle;
+    uint32_t triangleCount;
+    float sortKey;
+};
+
+/**
+ * Hard boundaries: where the three vertices of a triangle miss the cache, the previous
+ * triangles can be moved away without making this one worse.
+ * Each hard cluster is split again if the parts stay cheap with a cold cache.
+ */
+static std::vector<Cluster> buildClusters(
+    const std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    float threshold,
+    uint32_t cacheSize
+) {
+    size_t triangleCount = indices.size() / 3;
+
+    std::vector<uint32_t> hardBoundaries;
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    // misses of each triangle in the stream order
+    std::vector<uint8_t> misses(triangleCount, 0);
+
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t vertex = indices[3 * t + k];
+            if (time - cacheTime[vertex] > cacheSize) {
+                cacheTime[vertex] = time++;
+                misses[t]++;
+            }
+        }
+
+        if (t == 0 || misses[t] == 3) {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+    std::vector<Cluster> clusters;
+    // a fresh simulation for each part: the cache is cold when a cluster is moved
+    std::fill(cacheTime.begin(), cacheTime.end(), 0);
+    time = cacheSize + 1;
+
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+        uint32_t begin = hardBoundaries[h];
+        uint32_t end = hardBoundaries[h + 1];
+
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            clusterMisses += misses[t];
+        }
+        float clusterAcmr = static_cast<float>(clusterMisses) / (end - begin);
+
+        uint32_t partBegin = begin;
+        uint32_t partMisses = 0;
+        // cold cache: everything before now is out of it
+        time += cacheSize + 1;
+
+        for (uint32_t t = begin; t < end; t++) {
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t vertex = indices[3 * t + k];
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                    partMisses++;
+                }
+            }
+
+            uint32_t partSize = t + 1 - partBegin;
+            bool isCheap = static_cast<float>(partMisses) / partSize <= threshold * clusterAcmr;
+
+            if (isCheap && t + 1 < end) {
+                clusters.push_back({partBegin, partSize, 0.0f});
+                partBegin = t + 1;
+                partMisses = 0;
+                time += cacheSize + 1;
+            }
+        }
+
+        clusters.push_back({partBegin, end - partBegin, 0.0f});
+    }
+
+    return clusters;
+}
+
+void optimizeOverdraw(
+    std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    float threshold,
+    uint32_t cacheSize
+) {
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0) {
+        return;
+    }
+
+    std::vector<Cluster> clusters = buildClusters(indices, vertices.size(), threshold, cacheSize);
+
+    // area weighted centroid of the surface
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        const glm::vec3& a = vertices[indices[3 * t + 0]].pos;
+        const glm::vec3& b = vertices[indices[3 * t + 1]].pos;
+        const glm::vec3& c = vertices[indices[3 * t + 2]].pos;
+
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    for (Cluster& cluster : clusters) {
+        glm::vec3 centroid(0.0f);
+        // sum of the non normalized face normals: area weighted
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (uint32_t t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.triangleCount; t++) {
+            const glm::vec3& a = vertices[indices[3 * t + 0]].pos;
+            const glm::vec3& b = vertices[indices[3 * t + 1]].pos;
+            const glm::vec3& c = vertices[indices[3 * t + 2]].pos;
+
+            glm::vec3 faceNormal = glm::cross(b - a, c - a);
+            float faceArea = glm::length(faceNormal);
+
+            centroid += (a + b + c) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f) {
+            centroid /= area;
+            // how much the cluster faces away from the center: likely to hide what is behind it
+            cluster.sortKey = glm::dot(centroid - meshCentroid, normal / normalLength);
+        }
+    }
+
+    // stable: equal keys keep the Tipsify order
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    for (const Cluster& cluster : clusters) {
+        output.insert(
+            output.end(),
+            indices.begin() + 3 * cluster.firstTriangle,
+            indices.begin() + 3 * (cluster.firstTriangle + cluster.triangleCount)
+        );
+    }
+
+    indices.swap(output);
+}
+
+/** twice the signed area of the 2D triangle (a, b, p), > 0 if counter clockwise */
+static float edgeFunction(const glm::vec3& a, const glm::vec3& b, float px, float py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+OverdrawStats analyzeOverdraw(
+    const std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    uint32_t resolution
+) {
+    OverdrawStats stats{};
+
+    if (indices.empty()) {
+        return stats;
+    }
+
+    mesh::Bounds bounds = mesh::computeBounds(vertices.data(), vertices.size());
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = glm::length(bounds.max - center);
+
+    if (radius <= 0.0f) {
+        return stats;
+    }
+
+    // 6 axes and 8 diagonals around the mesh
+    std::vector<glm::vec3> directions;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int z = -1; z <= 1; z++) {
+                int nonZero = (x != 0) + (y != 0) + (z != 0);
+                if (nonZero == 1 || nonZero == 3) {
+                    directions.push_back(glm::normalize(glm::vec3(x, y, z)));
+                }
+            }
+        }
+    }
+
+    std::vector<float> depthBuffer(resolution * resolution);
+    std::vector<glm::vec3> projected(vertices.size());
+    uint64_t shaded = 0;
+    uint64_t covered = 0;
+
+    for (const glm::vec3& direction : directions) {
+        // view basis: looking along direction
+        glm::vec3 up = std::abs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 right = glm::normalize(glm::cross(direction, up));
+        up = glm::cross(right, direction);
+
+        // orthographic projection of the bounding sphere on the whole target
+        float scale = resolution / (2.0f * radius);
+        for (size_t v = 0; v < vertices.size(); v++) {
+            glm::vec3 relative = vertices[v].pos - center;
+            projected[v] = glm::vec3(
+                (glm::dot(relative, right) + radius) * scale,
+                (glm::dot(relative, up) + radius) * scale,
+                glm::dot(relative, direction)
+            );
+        }
+
+        std::fill(depthBuffer.begin(), depthBuffer.end(), std::numeric_limits<float>::max());
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec3& a = projected[indices[i + 0]];
+            const glm::vec3& b = projected[indices[i + 1]];
+            const glm::vec3& c = projected[indices[i + 2]];
+
+            // x right, y up and looking along direction: counter clockwise is facing us
+            float area = edgeFunction(a, b, c.x, c.y);
+            if (area <= 0.0f) {
+                continue;
+            }
+
+            int minX = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+            int maxX = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+            int minY = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+            int maxY = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+
+            for (int y = minY; y <= maxY; y++) {
+                for (int x = minX; x <= maxX; x++) {
+                    // pixel centers
+                    float px = x + 0.5f;
+                    float py = y + 0.5f;
+
+                    float w0 = edgeFunction(b, c, px, py);
+                    float w1 = edgeFunction(c, a, px, py);
+                    float w2 = edgeFunction(a, b, px, py);
+
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+                        continue;
+                    }
+
+                    float depth = (w0 * a.z + w1 * b.z + w2 * c.z) / area;
+                    float& stored = depthBuffer[y * resolution + x];
+
+                    // early depth test: only the fragments passing it are shaded
+                    if (depth < stored) {
+                        if (stored == std::numeric_limits<float>::max()) {
+                            covered++;
+                        }
+                        stored = depth;
+                        shaded++;
+                    }
+                }
+            }
+        }
+    }
+
+    stats.overdraw = covered > 0 ? static_cast<float>(shaded) / covered : 0.0f;
+
+    return stats;
+}
+
+Report optimize(mesh::Mesh& mesh, const Options& options, Extras* extras) {
+    Report report{};
+
+    if (options.analyze) {
+        report.cacheBefore = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+        report.overdrawBefore = analyzeOverdraw(mesh.indices, mesh.vertices);
+    }
+
+    if (options.vertexCache) {
+        optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    }
+
+    // needs the cache friendly order to build its clusters
+    if (options.overdraw) {
+        optimizeOverdraw(mesh.indices, mesh.vertices, options.overdrawThreshold);
+    }
+
+    // seeded in the current order, the overdraw one is mostly kept
+    if (options.meshlets && extras != nullptr) {
+        extras->meshlets = meshlet::build(mesh.indices, mesh.vertices);
+    }
+
+    size_t fullIndexCount = mesh.indices.size();
+
+    // the simplification keeps the order of the remaining triangles,
+    // with holes everywhere: each level gets its own pass for the vertex cache
+    if (options.lodCount > 0 && extras != nullptr) {
+        extras->lods = lod::buildChain(mesh.indices, mesh.vertices, options.lodCount, options.lodRatio);
+
+        for (size_t i = 1; i < extras->lods.size() && options.vertexCache; i++) {
+            auto first = mesh.indices.begin() + extras->lods[i].firstIndex;
+            std::vector<uint32_t> levelIndices(first, first + extras->lods[i].indexCount);
+            optimizeVertexCache(levelIndices, mesh.vertices.size());
+            std::copy(levelIndices.begin(), levelIndices.end(), first);
+        }
+    }
+
+    // the full resolution indices come first: they decide the order of the vertices
+    if (options.vertexFetch) {
+        optimizeVertexFetch(mesh.vertices, mesh.indices);
+    }
+
+    if (options.analyze) {
+        std::vector<uint32_t> fullIndices(mesh.indices.begin(), mesh.indices.begin() + fullIndexCount);
+        report.cacheAfter = analyzeVertexCache(fullIndices, mesh.vertices.size());
+        report.overdrawAfter = analyzeOverdraw(fullIndices, mesh.vertices);
+    }
+
+    return report;
+}
+
+uint64_t hashOptions(const Options& options) {
+    uint32_t thresholdBits;
+    memcpy(&thresholdBits, &options.overdrawThreshold, sizeof(thresholdBits));
+    uint32_t lodRatioBits;
+    memcpy(&lodRatioBits, &options.lodRatio, sizeof(lodRatioBits));
+
+    // analyze does not change the output
+    const uint64_t values[] = {
+        options.vertexCache,
+        options.overdraw,
+        options.overdraw ? thresholdBits : 0u,
+        options.meshlets,
+        options.vertexFetch,
+        options.lodCount,
+        options.lodCount > 0 ? lodRatioBits : 0u
+    };
+
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t value : values) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+#include "mesh.hpp"
+#include "meshlet.hpp"
+#include "lod.hpp"
+
+namespace meshopt {
+
+/**
+ * GPUs keep the output of the last vertex shader invocations in a small cache
+ * (the post-transform cache), indexed by the vertex index: a triangle referencing
+ * a vertex still in the cache does not run the vertex shader for it again.
+ * The triangle order coming from the OBJ file has no reason to be cache friendly.
+ *
+ * 16 is a conservative size, actual hardware is in the 16-32 range
+ * and is not always a plain FIFO, but optimizing for a smaller cache
+ * does not hurt bigger ones much.
+ */
+const uint32_t DEFAULT_CACHE_SIZE = 16;
+
+struct CacheStats {
+    /**
+     * Average Cache Miss Ratio: vertex shader invocations per triangle.
+     * 3 is the worst, ~0.5 the best possible on big regular meshes
+     */
+    float acmr;
+    /**
+     * Average Transformed Vertex Ratio: vertex shader invocations per vertex.
+     * 1 is the best possible, every vertex shaded once
+     */
+    float atvr;
+};
+
+/** simulates a FIFO cache of cacheSize entries on the triangle list */
+CacheStats analyzeVertexCache(
+    const std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    uint32_t cacheSize = DEFAULT_CACHE_SIZE
+);
+
+/**
+ * Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw", 2007): reorders the triangles in linear time.
+ * From the current vertex ("fanning" vertex) all its remaining triangles are emitted,
+ * then the next fanning vertex is picked among the vertices just emitted,
+ * favouring the ones still in the cache, and which will stay in it while
+ * their remaining triangles are emitted.
+ */
+void optimizeVertexCache(
+    std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    uint32_t cacheSize = DEFAULT_CACHE_SIZE
+);
+
+/**
+ * After the triangles are reordered, the vertices are fetched all over the vertex buffer:
+ * they are renumbered in order of first use, so the vertex fetches are mostly sequential
+ * (pre-transform cache, memory pages). Unreferenced vertices are removed.
+ * To be called after optimizeVertexCache.
+ */
+void optimizeVertexFetch(
+    std::vector<vertex::Vertex>& vertices,
+    std::vector<uint32_t>& indices
+);
+
+/**
+ * Once the vertex cache is happy, the order of the triangles still decides how many
+ * fragments are shaded for nothing: with the depth test, a fragment hidden by a triangle
+ * drawn *before* it is rejected early, but one hidden by a triangle drawn after it
+ * has already been shaded (and the texture sampled).
+ *
+ * Second part of the Tipsify paper: the triangles are split in clusters that are cheap
+ * for the vertex cache, and the clusters are sorted so the ones likely to occlude
+ * the others from most view points are drawn first: far from the mesh center and
+ * facing outward (a view independent approximation of front to back).
+ *
+ * threshold: a cluster is split only if each part, drawn with a cold cache, has
+ * an ACMR within threshold times the one of the whole cluster.
+ * 1.0 keeps the Tipsify ACMR, higher values make more and smaller clusters.
+ * To be called after optimizeVertexCache.
+ */
+void optimizeOverdraw(
+    std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    float threshold = 1.05f,
+    uint32_t cacheSize = DEFAULT_CACHE_SIZE
+);
+
+struct OverdrawStats {
+    /** shaded fragments per covered pixel, 1 is the best possible */
+    float overdraw;
+};
+
+/**
+ * Software rasterization of the mesh, in index order, from several view directions around it
+ * (orthographic, back face culling with counter clockwise front faces like our pipeline,
+ * and early depth test): counts the fragments passing the depth test when they are drawn.
+ */
+OverdrawStats analyzeOverdraw(
+    const std::vector<uint32_t>& indices,
+    const std::vector<vertex::Vertex>& vertices,
+    uint32_t resolution = 256
+);
+
+/** the stages of the import pipeline, run by optimize() */
+struct Options {
+    bool vertexCache = true;
+    bool overdraw = true;
+    float overdrawThreshold = 1.05f;
+    /** only if optimize() is given somewhere to put them */
+    bool meshlets = true;
+    /** simplified levels appended to the index buffer, 0 for none (also needs somewhere to put them) */
+    uint32_t lodCount = 4;
+    /** triangles of a level relative to the previous one */
+    float lodRatio = 0.5f;
+    bool vertexFetch = true;
+    /**
+     * fills the Report: not free on big meshes (the overdraw rasterization),
+     * so only for whoever prints it
+     */
+    bool analyze = false;
+};
+
+/** what optimize() builds besides the optimized mesh */
+struct Extras {
+    /** of the full resolution level */
+    std::vector<meshlet::Meshlet> meshlets;
+    /** the full resolution level first, always there when lodCount is not 0 */
+    std::vector<lod::Lod> lods;
+};
+
+/** the analysis is done on the full resolution level */
+struct Report {
+    CacheStats cacheBefore;
+    CacheStats cacheAfter;
+    OverdrawStats overdrawBefore;
+    OverdrawStats overdrawAfter;
+};
+
+/**
+ * runs the enabled stages in order: vertex cache, overdraw, meshlets, levels of detail, vertex fetch
+ * (the meshlets reorder the triangles again, the levels are appended after the full resolution
+ * indices and reordered for the vertex cache, the vertices are renumbered last, for all the levels)
+ */
+Report optimize(mesh::Mesh& mesh, const Options& options, Extras* extras = nullptr);
+
+/** the options change the output: to be part of the cache key */
+uint64_t hashOptions(const Options& options);
+
+}
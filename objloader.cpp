@@ -0,0 +1,418 @@
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "objloader.hpp"
+
+namespace objloader {
+
+/** no texture coordinate given for the corner (e.g. "f 1//1 2//2 3//3") */
+static const int32_t MISSING = INT32_MIN;
+
+/** indices are 0 based: either absolute or local to the chunk (relative in the file) */
+struct Corner {
+    int32_t position;
+    int32_t texcoord;
+    bool positionIsLocal;
+    bool texcoordIsLocal;
+};
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    // the corners of the faces, in order
+    std::vector<Corner> corners;
+    // 3 or 4 corners per face: quads are split once their positions are known
+    std::vector<uint8_t> faceSizes;
+    // the corners resolved against all the chunks, one vertex per corner
+    std::vector<vertex::Vertex> vertices;
+    // exceptions can't cross threads, the merge throws it
+    std::string error;
+};
+
+static const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    return p;
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value) {
+    p = skipSpaces(p, end);
+    // from_chars does not accept an explicit '+'
+    if (p < end && *p == '+') {
+        p++;
+    }
+
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("failed to parse OBJ number!");
+    }
+
+    return result.ptr;
+}
+
+/**
+ * OBJ indices start at 1, negative ones count back from the last defined element:
+ * absolute ones are made 0 based, relative ones local to the chunk (may be negative,
+ * pointing in a previous chunk)
+ */
+static const char* parseIndex(const char* p, const char* end, size_t localCount, int32_t& index, bool& isLocal) {
+    int32_t value;
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc() || value == 0) {
+        throw std::runtime_error("failed to parse OBJ face index!");
+    }
+
+    if (value > 0) {
+        index = value - 1;
+        isLocal = false;
+    } else {
+        index = static_cast<int32_t>(localCount) + value;
+        isLocal = true;
+    }
+
+    return result.ptr;
+}
+
+static void parseFace(const char* p, const char* end, Chunk& chunk) {
+    // small polygons, no allocation in the common case
+    Corner polygon[16];
+    std::vector<Corner> bigPolygon;
+    size_t cornerCount = 0;
+
+    size_t positionCount = chunk.positions.size() / 3;
+    size_t texcoordCount = chunk.texcoords.size() / 2;
+
+    while (true) {
+        p = skipSpaces(p, end);
+        if (p >= end) {
+            break;
+        }
+
+        Corner corner{};
+        corner.texcoord = MISSING;
+
+        // v, v/vt, v//vn or v/vt/vn
+        p = parseIndex(p, end, positionCount, corner.position, corner.positionIsLocal);
+        if (p < end && *p == '/') {
+            p++;
+            if (p < end && *p != '/') {
+                p = parseIndex(p, end, texcoordCount, corner.texcoord, corner.texcoordIsLocal);
+            }
+            if (p < end && *p == '/') {
+                p++;
+                // normals are not used, only skip them
+                while (p < end && *p != ' ' && *p != '\t') {
+                    p++;
+                }
+            }
+        }
+
+        if (cornerCount < 16) {
+            polygon[cornerCount] = corner;
+        } else {
+            if (bigPolygon.empty()) {
+                bigPolygon.assign(polygon, polygon + 16);
+            }
+            bigPolygon.push_back(corner);
+        }
+        cornerCount++;
+    }
+
+    if (cornerCount < 3) {
+        throw std::runtime_error("OBJ face with less than 3 vertices!");
+    }
+
+    const Corner* corners = cornerCount <= 16 ? polygon : bigPolygon.data();
+
+    // tinyobj splits quads along their shortest diagonal: the positions may be
+    // in another chunk, the quad is kept whole until the second pass
+    if (cornerCount == 4) {
+        chunk.corners.insert(chunk.corners.end(), corners, corners + 4);
+        chunk.faceSizes.push_back(4);
+        return;
+    }
+
+    // fan triangulation for the other polygons
+    // (tinyobj clips ears, the same triangles for convex polygons but maybe not in the same order)
+    for (size_t i = 1; i + 1 < cornerCount; i++) {
+        chunk.corners.push_back(corners[0]);
+        chunk.corners.push_back(corners[i]);
+        chunk.corners.push_back(corners[i + 1]);
+        chunk.faceSizes.push_back(3);
+    }
+}
+
+static void parseChunk(Chunk& chunk) {
+    try {
+        const char* p = chunk.begin;
+
+        while (p < chunk.end) {
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\n', chunk.end - p));
+            if (lineEnd == nullptr) {
+                lineEnd = chunk.end;
+            }
+
+            const char* next = lineEnd + (lineEnd < chunk.end ? 1 : 0);
+
+            // windows line endings
+            if (lineEnd > p && lineEnd[-1] == '\r') {
+                lineEnd--;
+            }
+
+            p = skipSpaces(p, lineEnd);
+
+            if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+                float x, y, z;
+                const char* q = parseFloat(p + 2, lineEnd, x);
+                q = parseFloat(q, lineEnd, y);
+                parseFloat(q, lineEnd, z);
+                // an optional w, or vertex colors, may follow: ignored
+                chunk.positions.push_back(x);
+                chunk.positions.push_back(y);
+                chunk.positions.push_back(z);
+            } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+                float u, v = 0.0f;
+                const char* q = parseFloat(p + 3, lineEnd, u);
+                // v is optional in the format
+                if (skipSpaces(q, lineEnd) < lineEnd) {
+                    parseFloat(q, lineEnd, v);
+                }
+                chunk.texcoords.push_back(u);
+                chunk.texcoords.push_back(v);
+            } else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+                parseFace(p + 2, lineEnd, chunk);
+            }
+            // everything else (comments, vn, o, g, s, usemtl, ...) is skipped
+
+            p = next;
+        }
+    } catch (const std::exception& e) {
+        chunk.error = e.what();
+    }
+}
+
+/** chunks of about the same size, each ending right after a '\n' */
+static std::vector<Chunk> splitChunks(const char* data, size_t size, unsigned threadCount, size_t minChunkSize) {
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / std::max<size_t>(1, minChunkSize)));
+    size_t chunkSize = size / chunkCount;
+
+    std::vector<Chunk> chunks;
+    const char* begin = data;
+    const char* end = data + size;
+
+    for (size_t i = 0; i < chunkCount && begin < end; i++) {
+        const char* chunkEnd = end;
+
+        if (i + 1 < chunkCount) {
+            chunkEnd = std::min(end, begin + chunkSize);
+            const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = newline ? newline + 1 : end;
+        }
+
+        Chunk chunk{};
+        chunk.begin = begin;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+
+        begin = chunkEnd;
+    }
+
+    return chunks;
+}
+
+/** fn(chunk) on each chunk, one thread per chunk (the current one takes the first) */
+template <class F>
+static void forEachChunk(std::vector<Chunk>& chunks, F fn) {
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); i++) {
+        workers.emplace_back([&chunks, &fn, i]() { fn(chunks[i], i); });
+    }
+    fn(chunks[0], 0);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (const auto& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            throw std::runtime_error(chunk.error);
+        }
+    }
+}
+
+static int64_t resolve(int32_t index, bool isLocal, size_t base, size_t total) {
+    int64_t resolved = isLocal ? static_cast<int64_t>(base) + index : index;
+
+    if (resolved < 0 || resolved >= static_cast<int64_t>(total)) {
+        throw std::runtime_error("OBJ face index out of range!");
+    }
+
+    return resolved;
+}
+
+mesh::Mesh load(const char* path, unsigned threadCount, size_t minChunkSize) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("failed to open ") + path + "!");
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("failed to open ") + path + "!");
+    }
+
+    size_t size = static_cast<size_t>(fileStat.st_size);
+    if (size == 0) {
+        close(fd);
+        return mesh::Mesh{};
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error(std::string("failed to map ") + path + "!");
+    }
+
+    // each thread reads its part once, from start to end
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<Chunk> chunks = splitChunks(static_cast<const char*>(mapping), size, threadCount, minChunkSize);
+
+    // first pass: the chunks are parsed independently
+    try {
+        forEachChunk(chunks, [](Chunk& chunk, size_t) { parseChunk(chunk); });
+    } catch (...) {
+        munmap(mapping, size);
+        throw;
+    }
+
+    munmap(mapping, size);
+
+    // prefix sums: number of positions / texcoords defined before each chunk
+    std::vector<size_t> positionBase(chunks.size());
+    std::vector<size_t> texcoordBase(chunks.size());
+    size_t positionCount = 0;
+    size_t texcoordCount = 0;
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+        positionBase[i] = positionCount;
+        texcoordBase[i] = texcoordCount;
+        positionCount += chunks[i].positions.size() / 3;
+        texcoordCount += chunks[i].texcoords.size() / 2;
+    }
+
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    positions.reserve(positionCount * 3);
+    texcoords.reserve(texcoordCount * 2);
+
+    for (auto& chunk : chunks) {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        // free as we go, big files
+        chunk.positions = std::vector<float>();
+        chunk.texcoords = std::vector<float>();
+    }
+
+    // second pass, also in parallel: the corners become vertices, now that all the
+    // positions and texcoords are known
+    forEachChunk(chunks, [&](Chunk& chunk, size_t i) {
+        try {
+            auto toVertex = [&](const Corner& corner) {
+                vertex::Vertex vertex{};
+
+                int64_t position = resolve(corner.position, corner.positionIsLocal, positionBase[i], positionCount);
+                vertex.pos = {
+                    positions[3 * position + 0],
+                    positions[3 * position + 1],
+                    positions[3 * position + 2]
+                };
+
+                if (corner.texcoord != MISSING) {
+                    int64_t texcoord = resolve(corner.texcoord, corner.texcoordIsLocal, texcoordBase[i], texcoordCount);
+                    vertex.texCoord = {
+                        texcoords[2 * texcoord + 0],
+                        // for OBJ format 0 means the bottom of the image
+                        // but we've uploaded the image to Vulkan in a top-bottom orientation
+                        // so we flip the vertical axis
+                        1.0f - texcoords[2 * texcoord + 1]
+                    };
+                }
+
+                vertex.color = {1.0f, 1.0f, 1.0f};
+                return vertex;
+            };
+
+            // 2 triangles for a quad
+            chunk.vertices.reserve(chunk.corners.size() * 3 / 2);
+
+            const Corner* corners = chunk.corners.data();
+            for (uint8_t faceSize : chunk.faceSizes) {
+                vertex::Vertex face[4];
+                for (uint8_t k = 0; k < faceSize; k++) {
+                    face[k] = toVertex(corners[k]);
+                }
+                corners += faceSize;
+
+                if (faceSize == 3) {
+                    chunk.vertices.insert(chunk.vertices.end(), face, face + 3);
+                    continue;
+                }
+
+                // the shortest diagonal, computed like tinyobj for the same split
+                glm::vec3 diagonal02 = face[2].pos - face[0].pos;
+                glm::vec3 diagonal13 = face[3].pos - face[1].pos;
+                float length02 = diagonal02.x * diagonal02.x + diagonal02.y * diagonal02.y + diagonal02.z * diagonal02.z;
+                float length13 = diagonal13.x * diagonal13.x + diagonal13.y * diagonal13.y + diagonal13.z * diagonal13.z;
+
+                const int split02[] = {0, 1, 2, 0, 2, 3};
+                const int split13[] = {0, 1, 3, 1, 2, 3};
+                for (int k : length02 < length13 ? split02 : split13) {
+                    chunk.vertices.push_back(face[k]);
+                }
+            }
+
+            chunk.corners = std::vector<Corner>();
+            chunk.faceSizes = std::vector<uint8_t>();
+        } catch (const std::exception& e) {
+            chunk.error = e.what();
+        }
+    });
+
+    // welding is the only sequential part: the indices depend on the order
+    // vertices are first seen, chunks in file order give the same output as a sequential parse
+    // there are at least as many unique vertices as positions in the file
+    mesh::MeshBuilder meshBuilder(positionCount);
+
+    for (auto& chunk : chunks) {
+        for (const auto& vertex : chunk.vertices) {
+            meshBuilder.addVertex(vertex);
+        }
+
+        chunk.vertices = std::vector<vertex::Vertex>();
+    }
+
+    return meshBuilder.build();
+}
+
+}
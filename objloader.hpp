@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh.hpp"
+
+namespace objloader {
+
+/** below this, splitting the file costs more than it saves */
+const size_t MIN_CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * In tree replacement for tinyobj::LoadObj, for our big scanned models (500MB+).
+ *
+ * tinyobj reads the file line by line on one thread, with stream based float parsing.
+ * Here the file is mmap'ed, split in chunks on line boundaries, and each chunk is parsed
+ * by its own thread with std::from_chars (no locale, no allocation).
+ *
+ * Faces can reference vertices with negative (relative) indices: -1 is the last position
+ * defined *before* the face, possibly in a previous chunk. Each chunk resolves them
+ * against its own count, and the counts of the previous chunks (prefix sums)
+ * are added when merging.
+ *
+ * Only positions, texture coordinates and faces are read (normals, groups and materials
+ * are ignored, like loadModel did). Quads are split along their shortest diagonal like
+ * tinyobj does, bigger polygons are triangulated as fans.
+ * The output is the same as loadModel with tinyobj: v flipped for Vulkan,
+ * white color, and identical vertices welded by mesh::MeshBuilder.
+ *
+ * threadCount: 0 for std::thread::hardware_concurrency()
+ * minChunkSize: no chunk smaller than this, a small one makes several chunks of
+ * a small file (e.g. to test the merge)
+ */
+mesh::Mesh load(const char* path, unsigned threadCount = 0, size_t minChunkSize = MIN_CHUNK_SIZE);
+
+}
@@ -0,0 +1,141 @@
+/**
+ * objloader::load must give exactly what the tinyobj based loadModel gave:
+ * the same welded vertices, in the same order, and the same indices,
+ * whatever the number of chunks the file is split in.
+ *
+ * Built by the "objloader test" task, run from the repository root.
+ * Returns EXIT_SUCCESS if both outputs are identical.
+ */
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include "mesh.hpp"
+#include "objloader.hpp"
+
+/** a real model, and a small one with relative indices across the chunks */
+const char* const MODEL_PATHS[] = {"models/viking_room.obj", "models/relative_indices.obj"};
+
+/** the reference: what loadModel did before objloader */
+mesh::Mesh loadWithTinyobj(const char* path) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path)) {
+        throw std::runtime_error(warn + err);
+    }
+
+    mesh::MeshBuilder meshBuilder(attrib.vertices.size() / 3);
+
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            vertex::Vertex vertex{};
+
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+
+            // v flipped for Vulkan
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            vertex.color = {1.0f, 1.0f, 1.0f};
+
+            meshBuilder.addVertex(vertex);
+        }
+    }
+
+    return meshBuilder.build();
+}
+
+/** bit for bit: the floats must be parsed to the same values */
+bool isSameVertex(const vertex::Vertex& a, const vertex::Vertex& b) {
+    return memcmp(&a.pos, &b.pos, sizeof(a.pos)) == 0
+        && memcmp(&a.color, &b.color, sizeof(a.color)) == 0
+        && memcmp(&a.texCoord, &b.texCoord, sizeof(a.texCoord)) == 0;
+}
+
+/** how objloader::load splits the file */
+struct Split {
+    unsigned threadCount;
+    size_t minChunkSize;
+};
+
+const Split SPLITS[] = {
+    // a single chunk, like any file smaller than objloader::MIN_CHUNK_SIZE
+    {1, objloader::MIN_CHUNK_SIZE},
+    // small chunks: every face line is far from the previous chunk boundaries, and
+    // the prefix sums and the relative indices are resolved across the chunks
+    {4, 64},
+    {16, 1},
+};
+
+/** the chunks as split by objloader: min(threadCount, size / minChunkSize), at least one */
+size_t getChunkCount(const char* path, const Split& split) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    size_t size = static_cast<size_t>(file.tellg());
+    return std::max<size_t>(1, std::min<size_t>(split.threadCount, size / split.minChunkSize));
+}
+
+/** returns false at the first difference */
+bool compare(const char* path) {
+    mesh::Mesh expected = loadWithTinyobj(path);
+
+    for (const Split& split : SPLITS) {
+        mesh::Mesh actual = objloader::load(path, split.threadCount, split.minChunkSize);
+
+        std::cout << path << ", " << getChunkCount(path, split) << " chunks: ";
+
+        if (actual.vertices.size() != expected.vertices.size()) {
+            std::cout << actual.vertices.size() << " vertices instead of " << expected.vertices.size() << std::endl;
+            return false;
+        }
+
+        for (size_t i = 0; i < expected.vertices.size(); i++) {
+            if (!isSameVertex(actual.vertices[i], expected.vertices[i])) {
+                std::cout << "vertex " << i << " differs" << std::endl;
+                return false;
+            }
+        }
+
+        if (actual.indices != expected.indices) {
+            std::cout << "the indices differ" << std::endl;
+            return false;
+        }
+
+        std::cout << actual.vertices.size() << " vertices, " << actual.indices.size()
+            << " indices, identical to tinyobj" << std::endl;
+    }
+
+    return true;
+}
+
+int main() {
+    try {
+        for (const char* path : MODEL_PATHS) {
+            if (!compare(path)) {
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
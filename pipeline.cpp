@@ -3,6 +3,7 @@
 
 #include "pipeline.hpp"
 #include "vertex.hpp"
+#include "buffer.hpp"
 
 namespace pipeline {
 
@@ -196,7 +197,8 @@ void createGraphicsPipeline(
     VkExtent2D swapChainExtent,
     VkSampleCountFlagBits msaaSampleCount,
     VkRenderPass renderPass,
-    const VkDescriptorSetLayout& descriptorSetLayout,
+    const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts,
+    const VkPipelineVertexInputStateCreateInfo& vertexInputInfo,
     VkPipelineLayout& pipelineLayout,
     VkPipeline& graphicsPipeline
 ) {
@@ -221,17 +223,8 @@ void createGraphicsPipeline(
 
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
+    // the bindings and attributes are given by the caller (see vertexlayout.hpp)
 
-    auto bindingDescription = vertex::Vertex::getBindingDescription();
-    auto attributeDescriptions = vertex::Vertex::getAttributeDescriptions();
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-    
     /**
      * 
         VK_PRIMITIVE_TOPOLOGY_POINT_LIST: points from vertices
@@ -384,13 +377,21 @@ void createGraphicsPipeline(
     colorBlending.blendConstants[2] = 0.0f; // Optional
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
+    // the per draw data, see buffer::DrawPushConstants
+    // vkCmdPushConstants must use exactly the stages of the range
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = DRAW_PUSH_CONSTANT_STAGES;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(buffer::DrawPushConstants);
+
     // For uniform values
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout; // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+    // one layout per set, see buffer::SetIndex
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
     if (vkCreatePipelineLayout(logical_device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!");
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <vector>
+
 // Let GLFW include by itslef vulkan headers
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 namespace pipeline {
 
+/**
+ * only the vertex shader reads the push block: the fragment stage is to be added
+ * once a fragment shader reads the material index
+ */
+const VkShaderStageFlags DRAW_PUSH_CONSTANT_STAGES = VK_SHADER_STAGE_VERTEX_BIT;
+
 /** the attachments referenced by the pipeline stages and their usage */
 void createRenderPass(
     VkDevice logical_device,
@@ -15,6 +23,11 @@ void createRenderPass(
     VkRenderPass& renderPass
 );
 
+/**
+ * vertexInputInfo has to match the vertex shader, e.g. vertex::Vertex::Layout::getInputState()
+ * with shader9.vert, vertex::PackedVertex::Layout::getInputState() with shader10.vert
+ * The layout has a push constant range of buffer::DrawPushConstants (DRAW_PUSH_CONSTANT_STAGES).
+ */
 void createGraphicsPipeline(
     const char* vert_file,
     const char* frag_file,
@@ -22,7 +35,8 @@ void createGraphicsPipeline(
     VkExtent2D swapChainExtent,
     VkSampleCountFlagBits msaaSampleCount,
     VkRenderPass renderPass,
-    const VkDescriptorSetLayout& descriptorSetLayout,
+    const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts,
+    const VkPipelineVertexInputStateCreateInfo& vertexInputInfo,
     VkPipelineLayout& pipelineLayout,
     VkPipeline& graphicsPipeline
 );
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "quantize.hpp"
+
+namespace quantize {
+
+uint16_t toHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t absolute = bits & 0x7fffffff;
+
+    // NaN stays a (quiet) NaN, infinity stays infinity
+    if (absolute >= 0x7f800000) {
+        return static_cast<uint16_t>(sign | 0x7c00 | (absolute > 0x7f800000 ? 0x200 : 0));
+    }
+
+    // too big for a half (65520 and more rounds up to infinity)
+    if (absolute >= 0x477ff000) {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+
+    // too small even for a half denormal: rounds to zero
+    if (absolute < 0x33000001) {
+        return static_cast<uint16_t>(sign);
+    }
+
+    uint32_t exponent = absolute >> 23;
+    uint32_t mantissa = absolute & 0x7fffff;
+    uint32_t shift;
+    uint32_t half;
+
+    if (exponent < 113) {
+        // half denormal: the implicit 1 becomes explicit and the mantissa is shifted further
+        mantissa |= 0x800000;
+        shift = 126 - exponent;
+        half = mantissa >> shift;
+    } else {
+        // rebias the exponent from 127 to 15
+        shift = 13;
+        half = ((exponent - 112) << 10) | (mantissa >> shift);
+    }
+
+    // round to nearest even with the bits shifted out
+    // (a carry into the exponent is still the right value)
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+        half++;
+    }
+
+    return static_cast<uint16_t>(sign | half);
+}
+
+uint16_t toUnorm16(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint16_t>(value * 65535.0f + 0.5f);
+}
+
+uint8_t toUnorm8(float value) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+PositionDequantization getPositionDequantization(const mesh::Bounds& bounds) {
+    PositionDequantization dequantization{};
+    dequantization.scale = bounds.max - bounds.min;
+    dequantization.offset = bounds.min;
+
+    return dequantization;
+}
+
+std::vector<vertex::PackedVertex> packVertices(
+    const vertex::Vertex* vertices,
+    size_t vertexCount,
+    const mesh::Bounds& bounds
+) {
+    glm::vec3 extent = bounds.max - bounds.min;
+    // a flat mesh has a zero extent on one axis: everything quantized to 0 on it
+    glm::vec3 inverseExtent(
+        extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 1.0f / extent.z : 0.0f
+    );
+
+    std::vector<vertex::PackedVertex> packed(vertexCount);
+
+    for (size_t i = 0; i < vertexCount; i++) {
+        const vertex::Vertex& vertex = vertices[i];
+        vertex::PackedVertex& output = packed[i];
+
+        glm::vec3 normalized = (vertex.pos - bounds.min) * inverseExtent;
+        output.pos[0] = toUnorm16(normalized.x);
+        output.pos[1] = toUnorm16(normalized.y);
+        output.pos[2] = toUnorm16(normalized.z);
+        output.pos[3] = 0;
+
+        output.color[0] = toUnorm8(vertex.color.x);
+        output.color[1] = toUnorm8(vertex.color.y);
+        output.color[2] = toUnorm8(vertex.color.z);
+        output.color[3] = 255;
+
+        output.texCoord[0] = toHalf(vertex.texCoord.x);
+        output.texCoord[1] = toHalf(vertex.texCoord.y);
+    }
+
+    return packed;
+}
+
+}
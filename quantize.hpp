@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "vertex.hpp"
+#include "mesh.hpp"
+
+namespace quantize {
+
+/** float to half float (IEEE 754 binary16), rounded to nearest even */
+uint16_t toHalf(float value);
+
+/** value clamped to [0, 1] and scaled to the 16 bits range, rounded to nearest */
+uint16_t toUnorm16(float value);
+
+/** value clamped to [0, 1] and scaled to the 8 bits range, rounded to nearest */
+uint8_t toUnorm8(float value);
+
+/**
+ * What the vertex shader needs to get the positions back:
+ * position = packed position * scale + offset
+ */
+struct PositionDequantization {
+    glm::vec3 scale;
+    glm::vec3 offset;
+};
+
+/** the box is mapped on [0, 1]^3, each axis with the full 16 bits precision */
+PositionDequantization getPositionDequantization(const mesh::Bounds& bounds);
+
+/**
+ * Vertex to PackedVertex. Positions are quantized relative to bounds (the bounds of the mesh,
+ * or bigger ones shared by several meshes): the error is at most half a step,
+ * (bounds.max - bounds.min) / 65535 / 2 on each axis, ~8 micrometers for a 1m model.
+ */
+std::vector<vertex::PackedVertex> packVertices(
+    const vertex::Vertex* vertices,
+    size_t vertexCount,
+    const mesh::Bounds& bounds
+);
+
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "recorder.hpp"
+
+namespace recorder {
+
+void ParallelRecorder::init(VkDevice logicalDevice, uint32_t queueFamily, uint32_t slotCount, unsigned threadCount) {
+    logicalDevice_ = logicalDevice;
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // rerecorded often: the whole pool is reset at once with vkResetCommandPool,
+    // cheaper than resetting its command buffers one by one
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    // executed by a primary command buffer of the same family
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    slots_.assign(slotCount, std::vector<ThreadSlot>(threadCount));
+
+    for (auto& threads : slots_) {
+        for (ThreadSlot& threadSlot : threads) {
+            if (vkCreateCommandPool(logicalDevice_, &poolInfo, nullptr, &threadSlot.commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording command pool!");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = threadSlot.commandPool;
+            // can't be submitted, only executed from a primary command buffer
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(logicalDevice_, &allocInfo, &threadSlot.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+        }
+    }
+
+    errors_.assign(threadCount, std::string());
+    isStopping_ = false;
+    generation_ = 0;
+
+    // the calling thread is the thread 0
+    for (size_t thread = 1; thread < threadCount; thread++) {
+        workers_.emplace_back(&ParallelRecorder::runWorker, this, thread);
+    }
+}
+
+void ParallelRecorder::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isStopping_ = true;
+    }
+    jobReady_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+
+    // frees their command buffers
+    for (auto& threads : slots_) {
+        for (ThreadSlot& threadSlot : threads) {
+            vkDestroyCommandPool(logicalDevice_, threadSlot.commandPool, nullptr);
+        }
+    }
+    slots_.clear();
+}
+
+size_t ParallelRecorder::getChunkCount(size_t drawCount) const {
+    size_t threadCount = workers_.size() + 1;
+    return std::max<size_t>(1, std::min(threadCount, drawCount / MIN_DRAWS_PER_CHUNK));
+}
+
+const std::vector<VkCommandBuffer>& ParallelRecorder::record(
+    uint32_t slot,
+    VkRenderPass renderPass,
+    VkFramebuffer framebuffer,
+    size_t drawCount,
+    const RecordFunction& fn
+) {
+    size_t chunkCount = getChunkCount(drawCount);
+
+    // the command buffers of the last time slot was recorded are done:
+    // one call per pool gives back all their memory for the new recording
+    for (size_t thread = 0; thread < chunkCount; thread++) {
+        vkResetCommandPool(logicalDevice_, slots_[slot][thread].commandPool, 0);
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.slot = slot;
+    job.inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    // the draws run inside this render pass, begun by the primary command buffer
+    job.inheritanceInfo.renderPass = renderPass;
+    job.inheritanceInfo.subpass = 0;
+    // optional, but lets the driver know the attachments when recording
+    job.inheritanceInfo.framebuffer = framebuffer;
+    job.drawCount = drawCount;
+    job.chunkCount = chunkCount;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = job;
+        generation_++;
+        pendingWorkers_ = chunkCount - 1;
+    }
+    if (chunkCount > 1) {
+        jobReady_.notify_all();
+    }
+
+    recordChunk(0, 0);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobDone_.wait(lock, [this]() { return pendingWorkers_ == 0; });
+    }
+
+    recorded_.clear();
+    for (size_t thread = 0; thread < chunkCount; thread++) {
+        if (!errors_[thread].empty()) {
+            std::string error = errors_[thread];
+            std::fill(errors_.begin(), errors_.end(), std::string());
+            throw std::runtime_error(error);
+        }
+        recorded_.push_back(slots_[slot][thread].commandBuffer);
+    }
+
+    return recorded_;
+}
+
+void ParallelRecorder::runWorker(size_t thread) {
+    uint64_t seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobReady_.wait(lock, [this, seenGeneration]() {
+                return isStopping_ || generation_ != seenGeneration;
+            });
+
+            if (isStopping_) {
+                return;
+            }
+            seenGeneration = generation_;
+
+            // not enough draws for this thread this time
+            if (thread >= job_.chunkCount) {
+                continue;
+            }
+        }
+
+        recordChunk(thread, thread);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pendingWorkers_--;
+        }
+        jobDone_.notify_one();
+    }
+}
+
+void ParallelRecorder::recordChunk(size_t thread, size_t chunk) {
+    // job_ is not written again before all the chunks are done
+    const Job& job = job_;
+    VkCommandBuffer commandBuffer = slots_[job.slot][thread].commandBuffer;
+
+    // the draws are split as evenly as possible
+    size_t first = job.drawCount * chunk / job.chunkCount;
+    size_t last = job.drawCount * (chunk + 1) / job.chunkCount;
+
+    try {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        // entirely inside the render pass
+        // not one time submit: a cached primary command buffer executes them again
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &job.inheritanceInfo;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer!");
+        }
+
+        (*job.fn)(commandBuffer, first, last);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+    } catch (const std::exception& e) {
+        errors_[thread] = e.what();
+    }
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+namespace recorder {
+
+/** below this, a chunk costs more to hand to a worker than to record */
+const size_t MIN_DRAWS_PER_CHUNK = 256;
+
+/** records the draws [first, last) in commandBuffer, binding all the state they need */
+using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, size_t first, size_t last)>;
+
+/**
+ * With thousands of draws, the CPU time of a frame is the recording of one primary
+ * command buffer on the main thread.
+ *
+ * The draws are split in chunks recorded in parallel in secondary command buffers,
+ * one chunk per thread (the calling thread takes the first), then executed in order
+ * by the primary with vkCmdExecuteCommands.
+ * A command pool can only be used by one thread at a time: each thread has its own,
+ * for each slot (a frame in flight, or a cached primary command buffer, see
+ * commandbuffer::RecordingCache) so a slot resets its pools while the others execute.
+ * The workers are started once and sleep between the frames.
+ *
+ * A secondary command buffer inherits nothing but the render pass:
+ * fn binds the pipeline, buffers, descriptor sets, viewport... in each of them.
+ *
+ * timeline::wait(point of frame) -> record(slot, ...) -> vkCmdBeginRenderPass(SECONDARY_COMMAND_BUFFERS)
+ * -> vkCmdExecuteCommands(returned buffers) -> vkCmdEndRenderPass
+ */
+class ParallelRecorder {
+public:
+    /** threadCount: 0 for std::thread::hardware_concurrency() */
+    void init(VkDevice logicalDevice, uint32_t queueFamily, uint32_t slotCount, unsigned threadCount = 0);
+
+    /** joins the workers, the device must be idle */
+    void destroy();
+
+    /** 1 when it is not worth splitting: record inline in the primary instead */
+    size_t getChunkCount(size_t drawCount) const;
+
+    /**
+     * Blocks until all the chunks of [0, drawCount) are recorded.
+     * The secondary command buffers of slot must not be executing anymore.
+     * Returns them in draw order, valid until the next record() of slot:
+     * a primary command buffer executing them must not be submitted after that.
+     * An exception thrown by fn on a worker is thrown again here.
+     */
+    const std::vector<VkCommandBuffer>& record(
+        uint32_t slot,
+        VkRenderPass renderPass,
+        VkFramebuffer framebuffer,
+        size_t drawCount,
+        const RecordFunction& fn
+    );
+
+private:
+    /** what a thread records for a slot */
+    struct ThreadSlot {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    /** the job of the current record() call */
+    struct Job {
+        const RecordFunction* fn = nullptr;
+        uint32_t slot = 0;
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        size_t drawCount = 0;
+        size_t chunkCount = 0;
+    };
+
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    /** [slot][thread], thread 0 is the calling one */
+    std::vector<std::vector<ThreadSlot>> slots_;
+    std::vector<VkCommandBuffer> recorded_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable jobReady_;
+    std::condition_variable jobDone_;
+    Job job_;
+    /** incremented for each job, a worker records once per generation */
+    uint64_t generation_ = 0;
+    size_t pendingWorkers_ = 0;
+    bool isStopping_ = false;
+    /** exceptions can't cross threads, record() throws it */
+    std::vector<std::string> errors_;
+
+    void runWorker(size_t thread);
+    void recordChunk(size_t thread, size_t chunk);
+};
+
+}
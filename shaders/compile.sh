@@ -11,6 +11,11 @@ ${GLSLC} -fshader-stage=vert shader2.vert.glsl -o ${OUTPUT_DIR}/shader2.vert.spi
 ${GLSLC} -fshader-stage=vert shader3.vert.glsl -o ${OUTPUT_DIR}/shader3.vert.spirv
 ${GLSLC} -fshader-stage=vert shader4.vert.glsl -o ${OUTPUT_DIR}/shader4.vert.spirv
 ${GLSLC} -fshader-stage=vert shader5.vert.glsl -o ${OUTPUT_DIR}/shader5.vert.spirv
+${GLSLC} -fshader-stage=vert shader7.vert.glsl -o ${OUTPUT_DIR}/shader7.vert.spirv
+${GLSLC} -fshader-stage=vert shader8.vert.glsl -o ${OUTPUT_DIR}/shader8.vert.spirv
+${GLSLC} -fshader-stage=vert shader9.vert.glsl -o ${OUTPUT_DIR}/shader9.vert.spirv
+${GLSLC} -fshader-stage=vert shader10.vert.glsl -o ${OUTPUT_DIR}/shader10.vert.spirv
 ${GLSLC} -fshader-stage=frag shader1.frag.glsl -o ${OUTPUT_DIR}/shader1.frag.spirv
 ${GLSLC} -fshader-stage=frag shader2.frag.glsl -o ${OUTPUT_DIR}/shader2.frag.spirv
-${GLSLC} -fshader-stage=frag shader3.frag.glsl -o ${OUTPUT_DIR}/shader3.frag.spirv
\ No newline at end of file
+${GLSLC} -fshader-stage=frag shader3.frag.glsl -o ${OUTPUT_DIR}/shader3.frag.spirv
+${GLSLC} -fshader-stage=frag shader4.frag.glsl -o ${OUTPUT_DIR}/shader4.frag.spirv
\ No newline at end of file
@@ -0,0 +1,35 @@
+#version 450
+
+/**
+* shader8 (vertex::PackedVertex) with the uniforms split by update frequency,
+* see shader9
+*/
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+layout(set = 2, binding = 0) uniform ObjectUniforms {
+    vec4 positionScale;
+    vec4 positionOffset;
+} object;
+
+// buffer::DrawPushConstants, pushed per draw with vkCmdPushConstants
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexColor;
+
+void main() {
+    vec3 position = inPosition.xyz * object.positionScale.xyz + object.positionOffset.xyz;
+    gl_Position = frame.proj * frame.view * draw.model * vec4(position, 1.0);
+    fragColor = inColor.rgb;
+    fragTexColor = inTexCoord;
+}
@@ -0,0 +1,15 @@
+#version 450
+
+/**
+* shader3 with the texture in the material set (set 1, see buffer::SetIndex)
+*/
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(texSampler, fragTexCoord);
+}
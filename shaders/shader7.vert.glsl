@@ -0,0 +1,31 @@
+#version 450
+
+/**
+* shader5 with the model matrix in push constants instead of the uniform buffer:
+* the uniform buffer only holds what is shared by the draws
+*/
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec4 positionScale;
+    vec4 positionOffset;
+} ubo;
+
+// buffer::DrawPushConstants, pushed per draw with vkCmdPushConstants
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexColor;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * draw.model * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexColor = inTexCoord;
+}
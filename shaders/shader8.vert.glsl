@@ -0,0 +1,32 @@
+#version 450
+
+/**
+* shader7 for vertex::PackedVertex: the positions are rescaled
+* with the dequantization constants of the mesh
+*/
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec4 positionScale;
+    vec4 positionOffset;
+} ubo;
+
+// buffer::DrawPushConstants, pushed per draw with vkCmdPushConstants
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexColor;
+
+void main() {
+    vec3 position = inPosition.xyz * ubo.positionScale.xyz + ubo.positionOffset.xyz;
+    gl_Position = ubo.proj * ubo.view * draw.model * vec4(position, 1.0);
+    fragColor = inColor.rgb;
+    fragTexColor = inTexCoord;
+}
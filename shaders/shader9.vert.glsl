@@ -0,0 +1,29 @@
+#version 450
+
+/**
+* shader7 with the uniforms split by update frequency (see buffer::SetIndex):
+* set 0 per frame, set 1 per material (shader4.frag), set 2 per object
+*/
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 view;
+    mat4 proj;
+} frame;
+
+// buffer::DrawPushConstants, pushed per draw with vkCmdPushConstants
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+} draw;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexColor;
+
+void main() {
+    gl_Position = frame.proj * frame.view * draw.model * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexColor = inTexCoord;
+}
@@ -0,0 +1,161 @@
+#include <stdexcept>
+
+#include "staging.hpp"
+#include "buffer.hpp"
+
+namespace staging {
+
+void StagingRing::init(
+    VkDevice logicalDevice,
+    memory::Allocator& allocator,
+    VkDeviceSize size
+) {
+    logicalDevice_ = logicalDevice;
+    allocator_ = &allocator;
+    size_ = size;
+
+    buffer::bindBuffer(
+        logicalDevice,
+        allocator,
+        size,
+        // Buffer can be used as source in a memory transfer operation.
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        // coherent so we don't have to flush after each memcpy
+        // in system memory: it is only read once by the copies
+        memorytype::UPLOAD,
+        buffer_,
+        allocation_
+    );
+}
+
+void StagingRing::destroy(memory::Allocator& allocator) {
+    vkDestroyBuffer(logicalDevice_, buffer_, nullptr);
+    allocator.free(allocation_);
+
+    for (InFlight& submission : inFlight_) {
+        destroyDedicated(submission.dedicatedBuffers);
+    }
+    inFlight_.clear();
+    destroyDedicated(pendingDedicatedBuffers_);
+}
+
+Region StagingRing::allocateDedicated(VkDeviceSize size) {
+    DedicatedBuffer dedicated{};
+
+    buffer::bindBuffer(
+        logicalDevice_,
+        *allocator_,
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        memorytype::UPLOAD,
+        dedicated.buffer,
+        dedicated.allocation
+    );
+
+    Region region{};
+    region.buffer = dedicated.buffer;
+    region.offset = 0;
+    region.size = size;
+    region.data = dedicated.allocation.mapped;
+
+    pendingDedicatedBuffers_.push_back(dedicated);
+
+    return region;
+}
+
+void StagingRing::destroyDedicated(std::vector<DedicatedBuffer>& dedicatedBuffers) {
+    for (DedicatedBuffer& dedicated : dedicatedBuffers) {
+        vkDestroyBuffer(logicalDevice_, dedicated.buffer, nullptr);
+        allocator_->free(dedicated.allocation);
+    }
+    dedicatedBuffers.clear();
+}
+
+void StagingRing::popCompleted() {
+    while (!inFlight_.empty()) {
+        InFlight& submission = inFlight_.front();
+
+        if (!timeline::isReached(logicalDevice_, submission.point)) {
+            break;
+        }
+
+        // submissions complete in order on a queue: everything before end is free
+        tail_ = submission.end;
+        destroyDedicated(submission.dedicatedBuffers);
+        inFlight_.pop_front();
+    }
+
+    // nothing in use anymore, restart from the beginning of the buffer
+    // so the next big region does not have to wrap
+    if (inFlight_.empty() && pendingStart_ == head_) {
+        head_ = tail_ = pendingStart_ = memory::alignUp(head_, size_);
+    }
+}
+
+Region StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    // would never fit: no need to wait for the ring to drain
+    if (size > size_) {
+        return allocateDedicated(size);
+    }
+
+    while (true) {
+        VkDeviceSize start = memory::alignUp(head_, alignment);
+
+        // a region is never split in two: if it doesn't fit before the end of
+        // the buffer, skip what is left and start again at the beginning
+        if (start % size_ + size > size_) {
+            start = memory::alignUp(start, size_);
+        }
+
+        if (start + size - tail_ <= size_) {
+            head_ = start + size;
+
+            Region region{};
+            region.buffer = buffer_;
+            region.offset = start % size_;
+            region.size = size;
+            region.data = static_cast<char*>(allocation_.mapped) + region.offset;
+
+            return region;
+        }
+
+        // full, first try to get back what the GPU already consumed
+        // then wait for the oldest submission
+        popCompleted();
+
+        if (start + size - tail_ <= size_) {
+            continue;
+        }
+
+        if (inFlight_.empty()) {
+            // only regions not submitted yet: waiting would never end
+            return allocateDedicated(size);
+        }
+
+        // reached values stay reached: popCompleted() frees it next iteration
+        timeline::wait(logicalDevice_, inFlight_.front().point);
+    }
+}
+
+void StagingRing::submit(const timeline::Point& point) {
+    if (pendingStart_ == head_ && pendingDedicatedBuffers_.empty()) {
+        return;
+    }
+
+    inFlight_.push_back({point, head_, std::move(pendingDedicatedBuffers_)});
+    pendingDedicatedBuffers_.clear();
+    pendingStart_ = head_;
+
+    // cheap, and keeps the ring from growing stale entries
+    popCompleted();
+}
+
+void StagingRing::reclaim() {
+    popCompleted();
+}
+
+VkDeviceSize StagingRing::getSize() const {
+    return size_;
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "memory.hpp"
+#include "timeline.hpp"
+
+namespace staging {
+
+const VkDeviceSize DEFAULT_RING_SIZE = 32 * 1024 * 1024;
+
+/** a piece of the ring the CPU can write to, and the GPU copy from */
+struct Region {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    /** offset in buffer, to be used as srcOffset / bufferOffset of the copy */
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    /** persistently mapped, write the data here */
+    void* data = nullptr;
+};
+
+/**
+ * Instead of creating, mapping, unmapping and destroying a staging buffer for each upload,
+ * we keep one host visible buffer mapped for the whole application time
+ * and use it as a ring: allocations are carved one after the other and wrap around
+ * at the end of the buffer.
+ *
+ * The GPU may still be reading the older regions, so every submit() closes the regions
+ * allocated so far with the timeline point of the submission reading them. Their space is
+ * given back only once that point is reached.
+ *
+ * A region that can't fit in the ring (bigger than it, e.g. a big texture, or the ring is
+ * full of regions not submitted yet) gets a staging buffer of its own, like before the ring:
+ * it is closed by the same submit() and destroyed once its point is reached.
+ */
+class StagingRing {
+public:
+    void init(
+        VkDevice logicalDevice,
+        memory::Allocator& allocator,
+        VkDeviceSize size = DEFAULT_RING_SIZE
+    );
+
+    /** the GPU must not use the ring anymore (e.g. after vkDeviceWaitIdle) */
+    void destroy(memory::Allocator& allocator);
+
+    /**
+     * Blocks on the oldest submissions if the ring is full.
+     * Falls back on a dedicated buffer if size can't fit, even after waiting.
+     */
+    Region allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+    /**
+     * The regions allocated since the last call are read by the submission
+     * that will signal point.
+     * A default point when the copies already completed (e.g. after vkQueueWaitIdle).
+     */
+    void submit(const timeline::Point& point);
+
+    /** give back the space of the completed submissions, never blocks */
+    void reclaim();
+
+    VkDeviceSize getSize() const;
+
+private:
+    /** a region which did not fit in the ring */
+    struct DedicatedBuffer {
+        VkBuffer buffer;
+        memory::Allocation allocation;
+    };
+
+    struct InFlight {
+        timeline::Point point;
+        // ring position right after the last region of the submission
+        VkDeviceSize end;
+        std::vector<DedicatedBuffer> dedicatedBuffers;
+    };
+
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    memory::Allocator* allocator_ = nullptr;
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    memory::Allocation allocation_;
+    VkDeviceSize size_ = 0;
+    /**
+     * head_ and tail_ grow forever (64 bits will not overflow) and the position in the
+     * buffer is their value modulo size_: head_ - tail_ is always the space in use,
+     * which removes the usual "empty or full" ambiguity when they are equal.
+     */
+    VkDeviceSize head_ = 0;
+    VkDeviceSize tail_ = 0;
+    /** start of the regions not submitted yet */
+    VkDeviceSize pendingStart_ = 0;
+    std::deque<InFlight> inFlight_;
+    /** allocated since the last submit() */
+    std::vector<DedicatedBuffer> pendingDedicatedBuffers_;
+
+    void popCompleted();
+    Region allocateDedicated(VkDeviceSize size);
+    void destroyDedicated(std::vector<DedicatedBuffer>& dedicatedBuffers);
+};
+
+}
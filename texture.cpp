@@ -6,27 +6,17 @@
 
 #include "texture.hpp"
 #include "buffer.hpp"
-#include "commandbuffer.hpp"
 #include "image.hpp"
 
 namespace texture {
 
-/**
- * If we were still using buffers, then we could now write a function to record and execute vkCmdCopyBufferToImage to finish the job,
- * but this command requires the image to be in the right layout first. 
- */
 void transitionImageLayout(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    VkCommandBuffer commandBuffer,
     VkImage image,
-    VkFormat format,
     VkImageLayout oldLayout,
     VkImageLayout newLayout,
     uint32_t mipLevels
 ) {
-    VkCommandBuffer commandBuffer = commandbuffer::beginSingleTimeCommands(logicalDevice, commandPool);
-
     // A pipeline barrier is used to synchronize access to resources
     // like writing to a buffer is complete before reading it
     // It can also be used to transition image layout
@@ -102,29 +92,20 @@ void transitionImageLayout(
         1,
         &barrier
     );
-
-
-    commandbuffer::endAndExecuteSingleTimeCommands(
-        logicalDevice,
-        commandPool,
-        graphicsQueue,
-        commandBuffer
-    );
 }
 
 void copyBufferToImage(
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    VkCommandBuffer commandBuffer,
     VkBuffer buffer,
+    VkDeviceSize bufferOffset,
     VkImage image,
     uint32_t width,
     uint32_t height
     ) {
-    VkCommandBuffer commandBuffer = commandbuffer::beginSingleTimeCommands(logicalDevice, commandPool);
-
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    // where the pixels start in buffer, e.g. the region of the staging ring
+    // must be a multiple of 4 and of the texel size
+    region.bufferOffset = bufferOffset;
     // how pixel are laid out in memory
     // here no padding between the rows of an image
     region.bufferRowLength = 0;
@@ -150,18 +131,11 @@ void copyBufferToImage(
         1,
         &region
     );
-
-    commandbuffer::endAndExecuteSingleTimeCommands(
-        logicalDevice,
-        commandPool,
-        graphicsQueue,
-        commandBuffer
-    );
 }
 
 void bindImageMemory(
-    VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
+    memory::Allocator& allocator,
     uint32_t width,
     uint32_t height,
     uint32_t mipLevels,
@@ -169,9 +143,9 @@ void bindImageMemory(
     VkFormat format,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
-    VkMemoryPropertyFlags properties,
+    const memorytype::Request& memoryRequest,
     VkImage& image,
-    VkDeviceMemory& imageMemory
+    memory::Allocation& imageAllocation
 ) {
     /**
      * Although we could set up the shader to access the pixel values in the buffer, 
@@ -240,28 +214,22 @@ void bindImageMemory(
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(logicalDevice, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = buffer::findMemoryType(
-        physicalDevice,
-        memRequirements.memoryTypeBits,
-        properties
-    );
+    bool isRenderTarget = usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
 
-    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
+    imageAllocation = allocator.allocate(
+        memRequirements,
+        memoryRequest,
+        tiling == VK_IMAGE_TILING_OPTIMAL ? memory::ResourceKind::Optimal : memory::ResourceKind::Linear,
+        isRenderTarget
+    );
 
     // Same for binding image memory and buffer memory
-    vkBindImageMemory(logicalDevice, image, imageMemory, 0);
+    vkBindImageMemory(logicalDevice, image, imageAllocation.memory, imageAllocation.offset);
 }
 
 void generateMipmaps(
     VkPhysicalDevice physicalDevice,
-    VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    VkCommandBuffer commandBuffer,
     VkImage image,
     VkFormat imageFormat,
     int32_t texWidth,
@@ -276,8 +244,6 @@ void generateMipmaps(
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
 
-    VkCommandBuffer commandBuffer = commandbuffer::beginSingleTimeCommands(logicalDevice, commandPool);
-
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
@@ -372,29 +338,74 @@ void generateMipmaps(
         0, nullptr,
         0, nullptr,
         1, &barrier);
+}
 
+void PixelsDeleter::operator()(unsigned char* pixels) const {
+    stbi_image_free(pixels);
+}
+
+DecodedImage decodeImage(const char* path) {
+    int texWidth;
+    int texHeight;
+    int texChannels;
+
+    // The pixels are laid out row by row with 4 bytes per pixel in the case of STBI_rgb_alpha
+    stbi_uc* pixels = stbi_load(path, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+    if (!pixels) {
+        throw std::runtime_error("failed to load texture image!");
+    }
 
-    commandbuffer::endAndExecuteSingleTimeCommands(logicalDevice, commandPool, graphicsQueue, commandBuffer);
+    DecodedImage image;
+    image.pixels.reset(pixels);
+    image.width = static_cast<uint32_t>(texWidth);
+    image.height = static_cast<uint32_t>(texHeight);
+
+    return image;
 }
 
 uint32_t createTextureImage(
     VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
     const char* path,
     VkSampleCountFlagBits msaaSampleCount,
     VkImage& textureImage,
-    VkDeviceMemory& textureImageMemory
+    memory::Allocation& textureImageAllocation
 ) {
-    int texWidth;
-    int texHeight;
-    int texChannels;
+    DecodedImage image = decodeImage(path);
 
-    stbi_uc* pixels = stbi_load(path, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    // The pixels are laid out row by row with 4 bytes per pixel in the case of STBI_rgb_alpha
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    // the pixels are copied in the staging ring, image frees them when going out of scope
+    return createTextureImage(
+        physicalDevice,
+        logicalDevice,
+        allocator,
+        uploadBatch,
+        image.pixels.get(),
+        image.width,
+        image.height,
+        msaaSampleCount,
+        textureImage,
+        textureImageAllocation
+    );
+}
 
+uint32_t createTextureImage(
+    VkPhysicalDevice physicalDevice,
+    VkDevice logicalDevice,
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
+    const void* pixels,
+    uint32_t width,
+    uint32_t height,
+    VkSampleCountFlagBits msaaSampleCount,
+    VkImage& textureImage,
+    memory::Allocation& textureImageAllocation
+) {
+    auto texWidth = static_cast<int32_t>(width);
+    auto texHeight = static_cast<int32_t>(height);
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
 
     /**
      * This calculates the number of levels in the mip chain. The max function selects the largest dimension. 
@@ -404,33 +415,9 @@ uint32_t createTextureImage(
      */
     auto mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture image!");
-    }
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    buffer::bindBuffer(
-        physicalDevice,
-        logicalDevice,
-        imageSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer,
-        stagingBufferMemory
-    );
-
-    void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
     bindImageMemory(
-        physicalDevice,
         logicalDevice,
+        allocator,
         texWidth,
         texHeight,
         mipLevels,
@@ -439,58 +426,34 @@ uint32_t createTextureImage(
         VK_IMAGE_TILING_OPTIMAL,
         // SRC bit added for the mipmaps generation
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        memorytype::GPU_ONLY,
         textureImage,
-        textureImageMemory
+        textureImageAllocation
     );
 
-    transitionImageLayout(
-        logicalDevice,
-        commandPool,
-        graphicsQueue,
+    // layout transition and copy of the level 0,
+    // recorded in the batch: nothing is executed yet
+    uploadBatch.copyToImage(
+        pixels,
+        imageSize,
         textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        // The image was created with the VK_IMAGE_LAYOUT_UNDEFINED layout
-        // We can only do that because we don't care of the format
-        // before the copy operation
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        width,
+        height,
         mipLevels
     );
 
-    copyBufferToImage(
-        logicalDevice,
-        commandPool,
-        graphicsQueue,
-        stagingBuffer,
+    // Each level is left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL by the copy,
+    // and transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL after the blit command reading from it is finished.
+    generateMipmaps(
+        physicalDevice,
+        uploadBatch.getGraphicsCommandBuffer(),
         textureImage,
-        static_cast<uint32_t>(texWidth),
-        static_cast<uint32_t>(texHeight)
+        VK_FORMAT_R8G8B8A8_SRGB,
+        texWidth,
+        texHeight,
+        mipLevels
     );
 
-    // Commented out at this will be handled by generatemipmaps
-    // This will leave each level of the texture image in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL. 
-    // Each level will be transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL after the blit command reading from it is finished.
-    // // To be able to start sampling from the texture image in the shader, 
-    // // we need one last transition to prepare it for shader access
-    // transitionImageLayout(
-    //     logicalDevice,
-    //     commandPool,
-    //     graphicsQueue,
-    //     textureImage,
-    //     VK_FORMAT_R8G8B8A8_SRGB,
-    //     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-    //     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-
-    //     mipLevels
-    // );
-
-    generateMipmaps(physicalDevice,logicalDevice, commandPool, graphicsQueue, textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
-
-    // clean up the stagin buffer
-    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
-
     return mipLevels;
 }
 
@@ -4,6 +4,12 @@
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
 
+#include <memory>
+#include <cstdint>
+
+#include "memory.hpp"
+#include "upload.hpp"
+
 namespace texture {
 
 /**
@@ -13,10 +19,12 @@ namespace texture {
  * TODO: maybe I am wrong ?
  * TODO: move outside texture as it may be used also for depth buffer, maybe in image.hpp ?
  * 
+ * Render targets (color/depth attachments) get a dedicated allocation: they are big,
+ * recreated with the swap chain, and drivers like to have them on their own.
  */
 void bindImageMemory(
-    VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
+    memory::Allocator& allocator,
     uint32_t width,
     uint32_t height,
     uint32_t mipLevels,
@@ -24,21 +32,98 @@ void bindImageMemory(
     VkFormat format,
     VkImageTiling tiling,
     VkImageUsageFlags usage,
-    VkMemoryPropertyFlags properties,
+    const memorytype::Request& memoryRequest,
     VkImage& image,
-    VkDeviceMemory& imageMemory
+    memory::Allocation& imageAllocation
+);
+
+/**
+ * The commands below are only recorded in commandBuffer,
+ * it is up to the caller to submit them (see upload::Batch)
+ */
+
+/**
+ * vkCmdCopyBufferToImage requires the image to be in the right layout first.
+ * Only UNDEFINED -> TRANSFER_DST and TRANSFER_DST -> SHADER_READ_ONLY are supported
+ */
+void transitionImageLayout(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    uint32_t mipLevels
+);
+
+/** copy the pixels at bufferOffset into the mip level 0 of image */
+void copyBufferToImage(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkDeviceSize bufferOffset,
+    VkImage image,
+    uint32_t width,
+    uint32_t height
+);
+
+/**
+ * blits each level from the previous one, all levels must be in TRANSFER_DST_OPTIMAL
+ * and are left in SHADER_READ_ONLY_OPTIMAL
+ */
+void generateMipmaps(
+    VkPhysicalDevice physicalDevice,
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    VkFormat imageFormat,
+    int32_t texWidth,
+    int32_t texHeight,
+    uint32_t mipLevels
 );
 
-/** returns the mipLevel of the image, calculated from its size */
+/** gives the pixels back to stb_image */
+struct PixelsDeleter {
+    void operator()(unsigned char* pixels) const;
+};
+
+/** RGBA, 4 bytes per pixel, row by row */
+struct DecodedImage {
+    std::unique_ptr<unsigned char, PixelsDeleter> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/**
+ * reads and decodes the image file, the slow part of loading a texture:
+ * no Vulkan call, it can run on a worker thread
+ */
+DecodedImage decodeImage(const char* path);
+
+/**
+ * returns the mipLevel of the image, calculated from its size.
+ * The upload and mipmaps generation are recorded in uploadBatch,
+ * the image can be sampled once the batch is submitted
+ */
 uint32_t createTextureImage(
     VkPhysicalDevice physicalDevice,
     VkDevice logicalDevice,
-    VkCommandPool commandPool,
-    VkQueue graphicsQueue,
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
     const char* path,
     VkSampleCountFlagBits msaaSampleCount,
     VkImage& textureImage,
-    VkDeviceMemory& textureImageMemory
+    memory::Allocation& textureImageAllocation
+);
+
+/** same from pixels already in memory (decodeImage, or generated), RGBA 4 bytes per pixel */
+uint32_t createTextureImage(
+    VkPhysicalDevice physicalDevice,
+    VkDevice logicalDevice,
+    memory::Allocator& allocator,
+    upload::Batch& uploadBatch,
+    const void* pixels,
+    uint32_t width,
+    uint32_t height,
+    VkSampleCountFlagBits msaaSampleCount,
+    VkImage& textureImage,
+    memory::Allocation& textureImageAllocation
 );
 
 // images are used through imageView rather than directly
@@ -0,0 +1,136 @@
+#include <stdexcept>
+
+#include "timeline.hpp"
+
+namespace timeline {
+
+bool isReached(VkDevice logicalDevice, const Point& point) {
+    if (point.semaphore == VK_NULL_HANDLE) {
+        return true;
+    }
+
+    uint64_t value;
+    if (vkGetSemaphoreCounterValue(logicalDevice, point.semaphore, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get timeline semaphore value!");
+    }
+
+    return value >= point.value;
+}
+
+void wait(VkDevice logicalDevice, const Point& point) {
+    if (point.semaphore == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &point.semaphore;
+    waitInfo.pValues = &point.value;
+
+    if (vkWaitSemaphores(logicalDevice, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+    }
+}
+
+void Timeline::init(VkDevice logicalDevice) {
+    logicalDevice_ = logicalDevice;
+    lastValue_ = 0;
+
+    // without it, vkCreateSemaphore creates a binary semaphore
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = lastValue_;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(logicalDevice_, &semaphoreInfo, nullptr, &semaphore_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+void Timeline::destroy() {
+    vkDestroySemaphore(logicalDevice_, semaphore_, nullptr);
+    semaphore_ = VK_NULL_HANDLE;
+}
+
+Point Timeline::next() {
+    lastValue_++;
+    return getLast();
+}
+
+Point Timeline::getLast() const {
+    Point point;
+    // value 0 is the initial value: already reached, no need to ask the driver
+    point.semaphore = lastValue_ == 0 ? VK_NULL_HANDLE : semaphore_;
+    point.value = lastValue_;
+    return point;
+}
+
+uint64_t Timeline::getCompletedValue() const {
+    uint64_t value;
+    if (vkGetSemaphoreCounterValue(logicalDevice_, semaphore_, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get timeline semaphore value!");
+    }
+    return value;
+}
+
+VkSemaphore Timeline::getSemaphore() const {
+    return semaphore_;
+}
+
+void submit(
+    VkQueue queue,
+    const std::vector<VkCommandBuffer>& commandBuffers,
+    const std::vector<Wait>& waits,
+    const std::vector<Point>& signals
+) {
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    for (const Wait& wait : waits) {
+        // nothing to wait for
+        if (wait.point.semaphore == VK_NULL_HANDLE) {
+            continue;
+        }
+        waitSemaphores.push_back(wait.point.semaphore);
+        waitValues.push_back(wait.point.value);
+        waitStages.push_back(wait.stage);
+    }
+
+    std::vector<VkSemaphore> signalSemaphores;
+    std::vector<uint64_t> signalValues;
+    for (const Point& signal : signals) {
+        signalSemaphores.push_back(signal.semaphore);
+        signalValues.push_back(signal.value);
+    }
+
+    // one value per semaphore, the ones of the binary semaphores are ignored
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    // no fence: the timeline values tell when it is done
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+}
+
+}
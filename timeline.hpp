@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+namespace timeline {
+
+/**
+ * A point on a timeline: reached once the semaphore counter is >= value.
+ * With a binary semaphore (swap chain acquire / present) the value is ignored.
+ * The default one, without semaphore, is always reached.
+ */
+struct Point {
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    uint64_t value = 0;
+};
+
+/** a submission waits for a point before stage */
+struct Wait {
+    Point point;
+    VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+};
+
+/** never blocks */
+bool isReached(VkDevice logicalDevice, const Point& point);
+
+/** blocks the CPU until the GPU reached point */
+void wait(VkDevice logicalDevice, const Point& point);
+
+/**
+ * Vulkan 1.2 timeline semaphore, one per queue.
+ *
+ * Instead of a fence per submission (created, waited on, reset, destroyed)
+ * every submission on the queue signals the next value of one counter:
+ * "is the work done" is "is the counter >= its value", for the CPU (wait / isReached)
+ * and for the other queues (a Wait in their submission).
+ * Nothing has to be reset, and the values of the completed work stay valid forever.
+ *
+ * The values are signaled in the order they are handed out by next(),
+ * so next() must be called in submission order on the queue.
+ */
+class Timeline {
+public:
+    void init(VkDevice logicalDevice);
+
+    /** the device must be idle */
+    void destroy();
+
+    /** the point to signal with the next submission on the queue */
+    Point next();
+
+    /** the point signaled by the last submission (always reached if none) */
+    Point getLast() const;
+
+    uint64_t getCompletedValue() const;
+
+    VkSemaphore getSemaphore() const;
+
+private:
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    VkSemaphore semaphore_ = VK_NULL_HANDLE;
+    uint64_t lastValue_ = 0;
+};
+
+/**
+ * vkQueueSubmit with the timeline values chained (VkTimelineSemaphoreSubmitInfo).
+ * waits and signals can mix binary and timeline semaphores.
+ */
+void submit(
+    VkQueue queue,
+    const std::vector<VkCommandBuffer>& commandBuffers,
+    const std::vector<Wait>& waits,
+    const std::vector<Point>& signals
+);
+
+}
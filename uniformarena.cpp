@@ -0,0 +1,75 @@
+#include <stdexcept>
+
+#include "uniformarena.hpp"
+#include "buffer.hpp"
+
+namespace uniformarena {
+
+void UniformArena::init(
+    VkPhysicalDevice physicalDevice,
+    VkDevice logicalDevice,
+    memory::Allocator& allocator,
+    uint32_t frameCount,
+    VkDeviceSize frameSize
+) {
+    logicalDevice_ = logicalDevice;
+
+    // 256 bytes on most desktop GPUs, down to 16 or 64 on others
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    alignment_ = properties.limits.minUniformBufferOffsetAlignment;
+
+    // every region starts aligned so the first block of each frame is too
+    frameSize_ = memory::alignUp(frameSize, alignment_);
+
+    buffer::bindBuffer(
+        logicalDevice,
+        allocator,
+        frameSize_ * frameCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        // host visible VRAM if there is some: read by every draw
+        memorytype::DYNAMIC,
+        buffer_,
+        allocation_
+    );
+
+    frameBegin_ = 0;
+    head_ = 0;
+}
+
+void UniformArena::destroy(memory::Allocator& allocator) {
+    vkDestroyBuffer(logicalDevice_, buffer_, nullptr);
+    allocator.free(allocation_);
+
+    buffer_ = VK_NULL_HANDLE;
+}
+
+void UniformArena::beginFrame(uint32_t frame) {
+    frameBegin_ = frameSize_ * frame;
+    head_ = 0;
+}
+
+Slice UniformArena::allocate(VkDeviceSize size) {
+    VkDeviceSize offset = memory::alignUp(head_, alignment_);
+    if (offset + size > frameSize_) {
+        throw std::runtime_error("failed to allocate in uniform arena!");
+    }
+    head_ = offset + size;
+
+    // the allocator already mapped the whole block for us
+    Slice slice;
+    slice.mapped = static_cast<char*>(allocation_.mapped) + frameBegin_ + offset;
+    // relative to the buffer: the descriptor is written with offset 0
+    slice.dynamicOffset = static_cast<uint32_t>(frameBegin_ + offset);
+    return slice;
+}
+
+VkBuffer UniformArena::getBuffer() const {
+    return buffer_;
+}
+
+VkDeviceSize UniformArena::getAlignment() const {
+    return alignment_;
+}
+
+}
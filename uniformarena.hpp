@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "memory.hpp"
+
+namespace uniformarena {
+
+/** per frame in flight: 16384 objects of a 256 bytes uniform block */
+const VkDeviceSize DEFAULT_FRAME_SIZE = 4 * 1024 * 1024;
+
+/** where a block was written: the pointer to fill, the offset to give to vkCmdBindDescriptorSets */
+struct Slice {
+    void* mapped = nullptr;
+    uint32_t dynamicOffset = 0;
+};
+
+/**
+ * One uniform buffer per frame in flight holds a single object. With many objects,
+ * a buffer (and a descriptor set) per object does not scale: the arena is one
+ * host visible buffer, persistently mapped, cut in one region per frame in flight.
+ * Each frame the data of every object is packed in the region of the frame, at
+ * offsets aligned to minUniformBufferOffsetAlignment.
+ *
+ * The descriptor is of type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, written once with
+ * offset 0 and the range of one object: the offset of the object is given per draw to
+ * vkCmdBindDescriptorSets (pDynamicOffsets), no descriptor update at all.
+ *
+ * beginFrame(frame) -> allocate() per object -> bind with slice.dynamicOffset per draw
+ *
+ * Like the uniform buffers, a region is only written once the timeline point of its frame was waited on.
+ */
+class UniformArena {
+public:
+    void init(
+        VkPhysicalDevice physicalDevice,
+        VkDevice logicalDevice,
+        memory::Allocator& allocator,
+        uint32_t frameCount,
+        VkDeviceSize frameSize = DEFAULT_FRAME_SIZE
+    );
+
+    /** the GPU must not use the buffer anymore */
+    void destroy(memory::Allocator& allocator);
+
+    /** the previous content of the region of frame is dropped */
+    void beginFrame(uint32_t frame);
+
+    /** size bytes in the region of the current frame, throws if it is full */
+    Slice allocate(VkDeviceSize size);
+
+    /** copies value in a new slice, returns its dynamic offset */
+    template <class T>
+    uint32_t push(const T& value) {
+        Slice slice = allocate(sizeof(T));
+        // memory is host coherent: no flush needed
+        *static_cast<T*>(slice.mapped) = value;
+        return slice.dynamicOffset;
+    }
+
+    VkBuffer getBuffer() const;
+    VkDeviceSize getAlignment() const;
+
+private:
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    memory::Allocation allocation_;
+    VkDeviceSize alignment_ = 0;
+    VkDeviceSize frameSize_ = 0;
+    /** the region being written */
+    VkDeviceSize frameBegin_ = 0;
+    VkDeviceSize head_ = 0;
+};
+
+}
@@ -0,0 +1,286 @@
+#include <stdexcept>
+#include <cstring>
+
+#include "upload.hpp"
+#include "buffer.hpp"
+#include "texture.hpp"
+
+namespace upload {
+
+void Batch::begin(
+    VkDevice logicalDevice,
+    commandbuffer::TransientPool& commandPool,
+    VkQueue queue,
+    timeline::Timeline& queueTimeline,
+    staging::StagingRing& stagingRing
+) {
+    Queue single{};
+    single.queue = queue;
+    single.commandPool = &commandPool;
+    single.timeline = &queueTimeline;
+
+    begin(logicalDevice, single, single, stagingRing);
+}
+
+void Batch::begin(
+    VkDevice logicalDevice,
+    const Queue& transferQueue,
+    const Queue& graphicsQueue,
+    staging::StagingRing& stagingRing
+) {
+    if (isPending()) {
+        throw std::runtime_error("upload batch already recording!");
+    }
+
+    logicalDevice_ = logicalDevice;
+    transfer_ = transferQueue;
+    graphics_ = graphicsQueue;
+    stagingRing_ = &stagingRing;
+    submitted_ = false;
+    hasBufferCopies_ = false;
+
+    commandBuffer_ = transfer_.commandPool->beginSingleTimeCommands();
+
+    if (isOwnershipTransfer()) {
+        graphicsCommandBuffer_ = graphics_.commandPool->beginSingleTimeCommands();
+    } else {
+        graphicsCommandBuffer_ = commandBuffer_;
+    }
+}
+
+bool Batch::isOwnershipTransfer() const {
+    return transfer_.family != graphics_.family;
+}
+
+void Batch::copyToBuffer(
+    const void* data,
+    VkDeviceSize size,
+    VkBuffer dstBuffer,
+    VkDeviceSize dstOffset
+) {
+    staging::Region stagingRegion = stagingRing_->allocate(size);
+    memcpy(stagingRegion.data, data, static_cast<size_t>(size));
+
+    buffer::copyBuffer(
+        commandBuffer_,
+        stagingRegion.buffer,
+        dstBuffer,
+        size,
+        stagingRegion.offset,
+        dstOffset
+    );
+
+    hasBufferCopies_ = true;
+
+    if (!isOwnershipTransfer()) {
+        return;
+    }
+
+    // the same barrier is recorded twice: release by the transfer family
+    // then acquire by the graphics family
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = transfer_.family;
+    barrier.dstQueueFamilyIndex = graphics_.family;
+    barrier.buffer = dstBuffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    // release: the access masks of the other queue are ignored
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+
+    vkCmdPipelineBarrier(
+        commandBuffer_,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, nullptr,
+        1, &barrier,
+        0, nullptr
+    );
+
+    // acquire: makes the writes visible to the vertex input and shaders
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        graphicsCommandBuffer_,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0,
+        0, nullptr,
+        1, &barrier,
+        0, nullptr
+    );
+}
+
+void Batch::copyToImage(
+    const void* pixels,
+    VkDeviceSize size,
+    VkImage image,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipLevels
+) {
+    // 16 bytes alignment keeps bufferOffset a multiple of the 4 bytes texels
+    staging::Region stagingRegion = stagingRing_->allocate(size, 16);
+    memcpy(stagingRegion.data, pixels, static_cast<size_t>(size));
+
+    texture::transitionImageLayout(
+        commandBuffer_,
+        image,
+        // The image was created with the VK_IMAGE_LAYOUT_UNDEFINED layout
+        // We can only do that because we don't care of the format
+        // before the copy operation
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        mipLevels
+    );
+
+    texture::copyBufferToImage(
+        commandBuffer_,
+        stagingRegion.buffer,
+        stagingRegion.offset,
+        image,
+        width,
+        height
+    );
+
+    if (!isOwnershipTransfer()) {
+        return;
+    }
+
+    // the layout does not change, only the owner
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = transfer_.family;
+    barrier.dstQueueFamilyIndex = graphics_.family;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+
+    vkCmdPipelineBarrier(
+        commandBuffer_,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier
+    );
+
+    // the mipmaps generation (blits) reads the level 0 and writes the others
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        graphicsCommandBuffer_,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier
+    );
+}
+
+VkCommandBuffer Batch::getGraphicsCommandBuffer() const {
+    return graphicsCommandBuffer_;
+}
+
+timeline::Point Batch::submit() {
+    if (hasBufferCopies_ && !isOwnershipTransfer()) {
+        // A submission on the same queue is ordered after us, but the writes of
+        // the copies still have to be made visible to the vertex input and shaders.
+        // One global memory barrier covers all the buffers of the batch.
+        // (with ownership transfer the acquire barriers already do it)
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            commandBuffer_,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr
+        );
+    }
+
+    if (vkEndCommandBuffer(commandBuffer_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    if (!isOwnershipTransfer()) {
+        completion_ = transfer_.timeline->next();
+        timeline::submit(transfer_.queue, {commandBuffer_}, {}, {completion_});
+    } else {
+        if (vkEndCommandBuffer(graphicsCommandBuffer_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        // the release barriers happen before the transfer timeline reaches copied
+        timeline::Point copied = transfer_.timeline->next();
+        timeline::submit(transfer_.queue, {commandBuffer_}, {}, {copied});
+
+        // and the acquire barriers after it is waited on
+        timeline::Wait waitCopied;
+        waitCopied.point = copied;
+        waitCopied.stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        // the graphics part is the last to execute, its point covers the whole batch
+        completion_ = graphics_.timeline->next();
+        timeline::submit(graphics_.queue, {graphicsCommandBuffer_}, {waitCopied}, {completion_});
+    }
+
+    // the staging regions of the batch are in use until the point is reached
+    stagingRing_->submit(completion_);
+    submitted_ = true;
+
+    return completion_;
+}
+
+bool Batch::isComplete() const {
+    return submitted_ && timeline::isReached(logicalDevice_, completion_);
+}
+
+void Batch::wait() {
+    if (!submitted_) {
+        throw std::runtime_error("waiting for an upload batch never submitted!");
+    }
+
+    timeline::wait(logicalDevice_, completion_);
+
+    // the staging regions of the batch are free now
+    stagingRing_->reclaim();
+
+    // executed: the command buffers go back to the pools, ready for the next batch
+    transfer_.commandPool->recycle(commandBuffer_);
+
+    if (isOwnershipTransfer()) {
+        graphics_.commandPool->recycle(graphicsCommandBuffer_);
+    }
+
+    completion_ = timeline::Point{};
+    commandBuffer_ = VK_NULL_HANDLE;
+    graphicsCommandBuffer_ = VK_NULL_HANDLE;
+    submitted_ = false;
+}
+
+bool Batch::isPending() const {
+    return commandBuffer_ != VK_NULL_HANDLE;
+}
+
+}
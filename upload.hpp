@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "staging.hpp"
+#include "commandbuffer.hpp"
+#include "timeline.hpp"
+
+namespace upload {
+
+/** a queue, its family, a transient pool created for that family and the timeline of the queue */
+struct Queue {
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t family = 0;
+    commandbuffer::TransientPool* commandPool = nullptr;
+    timeline::Timeline* timeline = nullptr;
+};
+
+/**
+ * The single time commands submit and then wait for the queue to be idle:
+ * loading a textured model was 5 full round trips to the GPU
+ * (vertex copy, index copy, layout transition, image copy, mipmaps).
+ *
+ * A batch records all the copies, barriers and mipmaps generation
+ * in one command buffer, submits it once signaling the timeline of the queue
+ * and lets the caller wait for it only when the data is really needed.
+ * Its command buffers come from the transient pools of the queues
+ * and go back to them in wait(): nothing is allocated per batch once the pools are warm.
+ *
+ * begin() -> copyToBuffer() / copyToImage() / getGraphicsCommandBuffer() ... -> submit() -> wait()
+ *
+ * With a dedicated transfer queue, the copies run on it while the graphics queue keeps rendering.
+ * Our resources are VK_SHARING_MODE_EXCLUSIVE, so their ownership has to be transferred:
+ * a release barrier on the transfer queue, and the matching acquire barrier on the graphics queue.
+ * The batch then has two command buffers, linked by a point on the transfer timeline:
+ * * transfer: copies and release barriers
+ * * graphics: acquire barriers and what only the graphics queue can do (vkCmdBlitImage for the mipmaps)
+ */
+class Batch {
+public:
+    /** everything on one queue */
+    void begin(
+        VkDevice logicalDevice,
+        commandbuffer::TransientPool& commandPool,
+        VkQueue queue,
+        timeline::Timeline& queueTimeline,
+        staging::StagingRing& stagingRing
+    );
+
+    /**
+     * copies on transferQueue, with ownership transfer to graphicsQueue.
+     * Falls back transparently to one command buffer when both are of the same family
+     * (no dedicated transfer family, e.g. lavapipe or most integrated GPUs)
+     */
+    void begin(
+        VkDevice logicalDevice,
+        const Queue& transferQueue,
+        const Queue& graphicsQueue,
+        staging::StagingRing& stagingRing
+    );
+
+    /** copy size bytes of data into dstBuffer, through the staging ring */
+    void copyToBuffer(
+        const void* data,
+        VkDeviceSize size,
+        VkBuffer dstBuffer,
+        VkDeviceSize dstOffset = 0
+    );
+
+    /**
+     * copy the pixels into the mip level 0 of image, through the staging ring.
+     * All the levels are left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, owned by the graphics queue:
+     * next is usually texture::generateMipmaps, recorded in getGraphicsCommandBuffer()
+     */
+    void copyToImage(
+        const void* pixels,
+        VkDeviceSize size,
+        VkImage image,
+        uint32_t width,
+        uint32_t height,
+        uint32_t mipLevels
+    );
+
+    /**
+     * to record anything else that needs the graphics queue (mipmaps, barriers),
+     * executed after the copies
+     */
+    VkCommandBuffer getGraphicsCommandBuffer() const;
+
+    /**
+     * ends the recording and submits, does not wait.
+     * Once the returned point is reached the whole batch is executed:
+     * another submission can wait for it on the GPU, without the CPU
+     */
+    timeline::Point submit();
+
+    /** true once the GPU executed the batch, never blocks */
+    bool isComplete() const;
+
+    /** blocks until the batch is executed, then recycles the command buffers */
+    void wait();
+
+    /** recorded or submitted, and not waited for yet */
+    bool isPending() const;
+
+private:
+    VkDevice logicalDevice_ = VK_NULL_HANDLE;
+    Queue transfer_;
+    Queue graphics_;
+    staging::StagingRing* stagingRing_ = nullptr;
+    // copies, on the transfer queue
+    VkCommandBuffer commandBuffer_ = VK_NULL_HANDLE;
+    // acquire barriers and graphics work, same as commandBuffer_ without ownership transfer
+    VkCommandBuffer graphicsCommandBuffer_ = VK_NULL_HANDLE;
+    // the point of the last submission of the batch
+    timeline::Point completion_;
+    bool submitted_ = false;
+    // a barrier is needed before the buffers are read as vertex, index or uniform
+    bool hasBufferCopies_ = false;
+
+    bool isOwnershipTransfer() const;
+};
+
+}
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <cstddef>
 
 // Let GLFW include by itslef vulkan headers
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "glm/glm.hpp"
 
+#include "vertexlayout.hpp"
+
 
 namespace vertex {
 
@@ -18,47 +22,102 @@ struct Vertex {
     glm::vec3 color;
     glm::vec2 texCoord;
 
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-
-        // index of the binding in the array of binding
-        bindingDescription.binding = 0;
-        // Note that functions in struct do not take any place in the object memory
-        // so no impact of sizeof(Vertex)
-        // it is just a shortcut for a free function with object pointer
-        // this as parameter
-        bindingDescription.stride = sizeof(Vertex);
-        // two possibilities
-        // VK_VERTEX_INPUT_RATE_VERTEX: Move to the next data entry after each vertex
-        // VK_VERTEX_INPUT_RATE_INSTANCE: Move to the next data entry after each instance
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
+    /**
+     * binding 0, one entry per vertex: two possibilities for the input rate
+     * VK_VERTEX_INPUT_RATE_VERTEX: Move to the next data entry after each vertex
+     * VK_VERTEX_INPUT_RATE_INSTANCE: Move to the next data entry after each instance
+     *
+     * the attributes in the order of the members, the format is the one of the glm type
+     * (R32G32B32_SFLOAT for a vec3 ...)
+     */
+    using Layout = vertexlayout::Layout<
+        vertexlayout::Stream<0, VK_VERTEX_INPUT_RATE_VERTEX,
+            vertexlayout::Attribute<0, glm::vec3>,
+            vertexlayout::Attribute<1, glm::vec3>,
+            vertexlayout::Attribute<2, glm::vec2>
+        >
+    >;
+
+    /** same buffer, only the position read: for a depth only pass */
+    using PositionOnlyLayout = vertexlayout::Layout<
+        vertexlayout::Stream<0, VK_VERTEX_INPUT_RATE_VERTEX,
+            vertexlayout::Attribute<0, glm::vec3>,
+            vertexlayout::Skip<sizeof(glm::vec3) + sizeof(glm::vec2)>
+        >
+    >;
+
+    // Note that functions in struct do not take any place in the object memory
+    // so no impact of sizeof(Vertex)
+    // it is just a shortcut for a free function with object pointer
+    // this as parameter
+    static constexpr VkVertexInputBindingDescription getBindingDescription() {
+        return Layout::bindingDescriptions[0];
     }
 
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        return Layout::attributeDescriptions;
+    }
+};
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        // byte size of the attribute. here for vec3
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+// the layout is computed from the types, it has to match what the compiler did with the struct
+static_assert(Vertex::Layout::bindingDescriptions[0].stride == sizeof(Vertex), "Vertex layout stride");
+static_assert(Vertex::Layout::attributeDescriptions[0].offset == offsetof(Vertex, pos), "Vertex layout pos");
+static_assert(Vertex::Layout::attributeDescriptions[1].offset == offsetof(Vertex, color), "Vertex layout color");
+static_assert(Vertex::Layout::attributeDescriptions[2].offset == offsetof(Vertex, texCoord), "Vertex layout texCoord");
+static_assert(Vertex::PositionOnlyLayout::bindingDescriptions[0].stride == sizeof(Vertex), "Vertex position only stride");
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        // byte size of the attribute. here for vec3
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
+/**
+ * Compact version of Vertex for the GPU: 16 bytes instead of 32, half the vertex fetch bandwidth.
+ * Written by quantize::packVertices, the formats are converted back to floats
+ * by the input assembler, the shader only has to rescale the position (shader8.vert, shader10.vert).
+ *
+ * * position: 16 bits unsigned normalized, relative to the mesh bounds
+ *   (the 4th component is padding, 3 components 16 bits formats are rarely supported for vertices)
+ * * color: 8 bits unsigned normalized, alpha unused
+ * * texture coordinates: half floats, they can go outside [0, 1] with a repeating sampler
+ */
+struct PackedVertex {
+    uint16_t pos[4];
+    uint8_t color[4];
+    uint16_t texCoord[2];
 
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        // byte size of the attribute. here for vec2
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+    /** same locations as Vertex: the fragment shader does not change */
+    using Layout = vertexlayout::Layout<
+        vertexlayout::Stream<0, VK_VERTEX_INPUT_RATE_VERTEX,
+            // read as a vec4 in [0, 1]
+            vertexlayout::Attribute<0, uint16_t[4], VK_FORMAT_R16G16B16A16_UNORM>,
+            vertexlayout::Attribute<1, uint8_t[4], VK_FORMAT_R8G8B8A8_UNORM>,
+            vertexlayout::Attribute<2, uint16_t[2], VK_FORMAT_R16G16_SFLOAT>
+        >
+    >;
 
-        return attributeDescriptions;
+    /**
+     * same buffer, the color not read: for a vertex shader without inColor (location 1),
+     * e.g. models whose color is all white like the OBJ ones
+     */
+    using NoColorLayout = vertexlayout::Layout<
+        vertexlayout::Stream<0, VK_VERTEX_INPUT_RATE_VERTEX,
+            vertexlayout::Attribute<0, uint16_t[4], VK_FORMAT_R16G16B16A16_UNORM>,
+            vertexlayout::Skip<sizeof(uint8_t[4])>,
+            vertexlayout::Attribute<2, uint16_t[2], VK_FORMAT_R16G16_SFLOAT>
+        >
+    >;
+
+    static constexpr VkVertexInputBindingDescription getBindingDescription() {
+        return Layout::bindingDescriptions[0];
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        return Layout::attributeDescriptions;
     }
 };
 
-}
\ No newline at end of file
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex is expected to be tightly packed");
+static_assert(PackedVertex::Layout::bindingDescriptions[0].stride == sizeof(PackedVertex), "PackedVertex layout stride");
+static_assert(PackedVertex::Layout::attributeDescriptions[0].offset == offsetof(PackedVertex, pos), "PackedVertex layout pos");
+static_assert(PackedVertex::Layout::attributeDescriptions[1].offset == offsetof(PackedVertex, color), "PackedVertex layout color");
+static_assert(PackedVertex::Layout::attributeDescriptions[2].offset == offsetof(PackedVertex, texCoord), "PackedVertex layout texCoord");
+static_assert(PackedVertex::NoColorLayout::bindingDescriptions[0].stride == sizeof(PackedVertex), "PackedVertex no color stride");
+static_assert(PackedVertex::NoColorLayout::attributeDescriptions[1].offset == offsetof(PackedVertex, texCoord), "PackedVertex no color texCoord");
+
+}
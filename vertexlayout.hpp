@@ -0,0 +1,217 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// Let GLFW include by itslef vulkan headers
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "glm/glm.hpp"
+
+namespace vertexlayout {
+
+/**
+ * Vertex layouts declared as types, the Vulkan descriptions computed at compile time:
+ *
+ *  using Layout = Layout<
+ *      Stream<0, VK_VERTEX_INPUT_RATE_VERTEX,
+ *          Attribute<0, glm::vec3>,
+ *          Attribute<1, glm::vec2>
+ *      >
+ *  >;
+ *
+ * Offsets follow the declaration order, tightly packed, and the stride is their sum:
+ * Skip<bytes> jumps over data a pass does not read (e.g. a position only layout
+ * on the interleaved vertices for a depth pass).
+ * Several streams are several bindings, e.g. positions in one buffer and
+ * the other attributes in another one, or per instance data.
+ *
+ * Everything ends in static constexpr arrays: no cost at runtime and
+ * the pointers given to Vulkan stay valid for the whole program.
+ */
+
+/** in bytes, 0 if not known here (add it when using a new format) */
+constexpr uint32_t getFormatSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+        case VK_FORMAT_R32_UINT:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32_SFLOAT:
+            return 12;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * the format for the types matching the shader ones,
+ * packed types (integers read as normalized floats, half floats) have to give theirs
+ */
+template <class T>
+struct DefaultFormat;
+
+template <>
+struct DefaultFormat<float> {
+    static constexpr VkFormat value = VK_FORMAT_R32_SFLOAT;
+};
+
+template <>
+struct DefaultFormat<glm::vec2> {
+    static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT;
+};
+
+template <>
+struct DefaultFormat<glm::vec3> {
+    static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT;
+};
+
+template <>
+struct DefaultFormat<glm::vec4> {
+    static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT;
+};
+
+template <>
+struct DefaultFormat<uint32_t> {
+    static constexpr VkFormat value = VK_FORMAT_R32_UINT;
+};
+
+/** T is the type of the member in the vertex struct, Location the one in the shader */
+template <uint32_t Location, class T, VkFormat Format = DefaultFormat<T>::value>
+struct Attribute {
+    static constexpr uint32_t location = Location;
+    static constexpr VkFormat format = Format;
+    static constexpr uint32_t size = sizeof(T);
+    static constexpr bool isPadding = false;
+
+    static_assert(getFormatSize(Format) == sizeof(T), "the format does not match the size of the type");
+};
+
+/** bytes of the vertex not read by the layout */
+template <uint32_t Size>
+struct Skip {
+    static constexpr uint32_t location = 0;
+    static constexpr VkFormat format = VK_FORMAT_UNDEFINED;
+    static constexpr uint32_t size = Size;
+    static constexpr bool isPadding = true;
+};
+
+/** one binding: the attributes (and Skip) in the order of the vertex struct */
+template <uint32_t Binding, VkVertexInputRate InputRate, class... Attributes>
+struct Stream {
+    static_assert(sizeof...(Attributes) > 0, "a stream needs at least one attribute");
+
+    static constexpr uint32_t binding = Binding;
+    static constexpr uint32_t stride = (Attributes::size + ...);
+    static constexpr size_t attributeCount = ((Attributes::isPadding ? 0 : 1) + ...);
+
+    static constexpr VkVertexInputBindingDescription getBindingDescription() {
+        return VkVertexInputBindingDescription{Binding, stride, InputRate};
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> getAttributeDescriptions() {
+        constexpr uint32_t locations[] = {Attributes::location...};
+        constexpr VkFormat formats[] = {Attributes::format...};
+        constexpr uint32_t sizes[] = {Attributes::size...};
+        constexpr bool isPadding[] = {Attributes::isPadding...};
+
+        std::array<VkVertexInputAttributeDescription, attributeCount> descriptions{};
+        uint32_t offset = 0;
+        size_t count = 0;
+
+        for (size_t i = 0; i < sizeof...(Attributes); i++) {
+            if (!isPadding[i]) {
+                descriptions[count++] = VkVertexInputAttributeDescription{locations[i], Binding, formats[i], offset};
+            }
+            offset += sizes[i];
+        }
+
+        return descriptions;
+    }
+};
+
+namespace detail {
+
+template <size_t Count, class... Streams>
+constexpr std::array<VkVertexInputAttributeDescription, Count> concatAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, Count> all{};
+    size_t count = 0;
+
+    auto append = [&all, &count](const auto& descriptions) {
+        for (const auto& description : descriptions) {
+            all[count++] = description;
+        }
+    };
+    (append(Streams::getAttributeDescriptions()), ...);
+
+    return all;
+}
+
+template <size_t Count>
+constexpr bool hasUniqueLocations(const std::array<VkVertexInputAttributeDescription, Count>& descriptions) {
+    for (size_t i = 0; i < Count; i++) {
+        for (size_t j = i + 1; j < Count; j++) {
+            if (descriptions[i].location == descriptions[j].location) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <size_t Count>
+constexpr bool hasUniqueBindings(const std::array<VkVertexInputBindingDescription, Count>& descriptions) {
+    for (size_t i = 0; i < Count; i++) {
+        for (size_t j = i + 1; j < Count; j++) {
+            if (descriptions[i].binding == descriptions[j].binding) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+/** all the streams read by a pipeline */
+template <class... Streams>
+struct Layout {
+    static constexpr size_t bindingCount = sizeof...(Streams);
+    static constexpr size_t attributeCount = (Streams::attributeCount + ...);
+
+    static constexpr std::array<VkVertexInputBindingDescription, bindingCount> bindingDescriptions = {
+        Streams::getBindingDescription()...
+    };
+
+    static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> attributeDescriptions =
+        detail::concatAttributeDescriptions<attributeCount, Streams...>();
+
+    static_assert(detail::hasUniqueBindings(bindingDescriptions), "two streams with the same binding");
+    static_assert(detail::hasUniqueLocations(attributeDescriptions), "two attributes with the same location");
+
+    /** to plug in VkGraphicsPipelineCreateInfo::pVertexInputState */
+    static VkPipelineVertexInputStateCreateInfo getInputState() {
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingCount);
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeCount);
+        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+        return vertexInputInfo;
+    }
+};
+
+}